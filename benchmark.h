@@ -4,113 +4,2648 @@
 #ifndef BENCHMARK_H
 #define BENCHMARK_H
 
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <cpuid.h>      //__get_cpuid_count
 #include <immintrin.h>  //__rdtsc
+#endif
 
+#if defined( __linux__ )
+#include <linux/perf_event.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <bit>
+#include <charconv>
 #include <chrono>
+#include <concepts>
+#include <coroutine>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <ios>
 #include <iostream>
+#include <limits>
+#include <optional>
+#include <random>
+#include <regex>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace {
 
-struct BenchmarkResult
+struct TscTimer
 {
-    std::string Title;
-    std::size_t TotalCycle;
-    std::size_t TotalIteration;
-    auto Latency() const { return TotalCycle / TotalIteration; }
-    auto Throughput() const { return 1000000000 * TotalIteration / TotalCycle; }
-    auto operator<( const auto& RHS ) const { return Title.length() < RHS.Title.length(); }
+    using clock = std::chrono::steady_clock;
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+    // lfence on both sides keeps the read from drifting into / out of the timed region
+    static std::uint64_t Start()
+    {
+        _mm_lfence();
+        auto Tick = __rdtsc();
+        _mm_lfence();
+        return Tick;
+    }
+
+    // rdtscp waits for every earlier instruction to retire, lfence holds back later ones
+    static std::uint64_t Stop()
+    {
+        unsigned int Aux;
+        auto Tick = __rdtscp( &Aux );
+        _mm_lfence();
+        return Tick;
+    }
+
+    // unserialized, a timestamp for spans far longer than the read itself
+    static std::uint64_t Now() { return __rdtsc(); }
+
+    static double NominalFrequency()
+    {
+        // leaf 0x15 : TSC / crystal ratio, only reliable when the crystal clock is enumerated
+        unsigned int Denominator, Numerator, CrystalHz, _;
+        if( __get_cpuid_count( 0x15, 0, &Denominator, &Numerator, &CrystalHz, &_ ) &&
+            Denominator != 0 && Numerator != 0 && CrystalHz != 0 )
+            return static_cast<double>( CrystalHz ) * Numerator / Denominator;
+
+        // exposed by some kernels / out-of-tree modules
+        auto KHz = 0.0;
+        if( std::ifstream{ "/sys/devices/system/cpu/cpu0/tsc_freq_khz" } >> KHz ) return KHz * 1e3;
+
+        return 0;
+    }
+#elif defined( __aarch64__ )
+    static std::uint64_t Start()
+    {
+        std::uint64_t Tick;
+        asm volatile( "isb\n\tmrs %0, cntvct_el0" : "=r"( Tick )::"memory" );
+        return Tick;
+    }
+
+    static std::uint64_t Stop() { return Start(); }
+
+    static std::uint64_t Now()
+    {
+        std::uint64_t Tick;
+        asm volatile( "mrs %0, cntvct_el0" : "=r"( Tick ) );
+        return Tick;
+    }
+
+    static double NominalFrequency()
+    {
+        std::uint64_t Hz;
+        asm volatile( "mrs %0, cntfrq_el0" : "=r"( Hz ) );
+        return static_cast<double>( Hz );
+    }
+#else
+    static std::uint64_t Start()
+    {
+        return static_cast<std::uint64_t>( clock::now().time_since_epoch().count() );
+    }
+
+    static std::uint64_t Stop() { return Start(); }
+
+    static std::uint64_t Now() { return Start(); }
+
+    static double NominalFrequency() { return 1.0 * clock::period::den / clock::period::num; }
+#endif
+
+    // invariant TSC assumed, so one measurement serves the whole process
+    static double Calibrate()
+    {
+        if( auto Hz = NominalFrequency(); Hz > 0 ) return Hz;
+
+        constexpr auto Window = std::chrono::milliseconds{ 20 };
+        auto Best             = 0.0;
+        for( auto Round = 0; Round < 3; ++Round )
+        {
+            const auto StartTime = clock::now();
+            const auto StartTick = Start();
+            while( clock::now() - StartTime < Window ) {}
+            const auto StopTick = Stop();
+            const auto StopTime = clock::now();
+            const auto Seconds  = std::chrono::duration<double>( StopTime - StartTime ).count();
+            Best                = std::max( Best, ( StopTick - StartTick ) / Seconds );
+        }
+        return Best;
+    }
+
+    static auto Frequency()
+    {
+        static const auto Hz = Calibrate();
+        return Hz;
+    }
+
+    static auto ToNanoseconds( double Ticks ) { return Ticks * 1e9 / Frequency(); }
+
+    static auto ToTicks( std::chrono::nanoseconds Duration )
+    {
+        return static_cast<std::uint64_t>( Duration.count() * Frequency() / 1e9 );
+    }
 };
 
-struct BenchmarkAnalyzer : std::vector<BenchmarkResult>
+// steady_clock in nanoseconds, for machines whose TSC cannot be trusted
+struct SteadyTimer
 {
-    std::size_t BaselinePos;
-    BenchmarkAnalyzer() : std::vector<BenchmarkResult>{}, BaselinePos{ 0 } { reserve( 10 ); }
+    using clock = std::chrono::steady_clock;
 
-    ~BenchmarkAnalyzer()
+    static std::uint64_t Start()
     {
-        const auto DigitWidth = 18;
-        const auto TitleWidth = std::max( std::max_element( begin(), end() )->Title.length(),  //
-                                          24ull );
-        const auto ThroughputBaseline =
-        static_cast<double>( ( *this )[ BaselinePos ].Throughput() );
-
-        auto cout_row = [ TW = std::setw( TitleWidth ), DW = std::setw( DigitWidth ) ](  //
-                        std::string_view Title,                                          //
-                        const auto Latency,                                              //
-                        const auto Throughput,                                           //
-                        const auto Relative,                                             //
-                        const char fill = ' ' )                                          //
-        {
-            std::cout << std::setfill( fill ) << std::left                       //
-                      << TW << Title << std::right                               //
-                      << DW << Latency                                           //
-                      << DW << Throughput                                        //
-                      << DW << std::setprecision( 2 ) << std::fixed << Relative  //
-                      << std::setfill( ' ' ) << '\n';
-        };
+        return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>( clock::now().time_since_epoch() )
+        .count() );
+    }
+
+    static std::uint64_t Stop() { return Start(); }
+
+    static double Frequency() { return 1e9; }
+
+    static auto ToTicks( std::chrono::nanoseconds Duration )
+    {
+        return static_cast<std::uint64_t>( Duration.count() );
+    }
+};
+
+// compiler barriers, no instruction is emitted for any of them
+
+#if defined( __clang__ )
+#define BENCHMARK_READ_WRITE "+r,m"
+#else
+#define BENCHMARK_READ_WRITE "+m,r"
+#endif
+
+// Value is treated as read and modified, and every pending store is flushed to memory
+template <typename T>
+inline void DoNotOptimize( T& Value )
+{
+    asm volatile( "" : BENCHMARK_READ_WRITE( Value ) : : "memory" );
+}
+
+template <typename T>
+inline void DoNotOptimize( const T& Value )
+{
+    asm volatile( "" : : "r,m"( Value ) : "memory" );
+}
+
+// forces every pending store to memory and every later load to be reissued
+inline void ClobberMemory() { asm volatile( "" : : : "memory" ); }
+
+// Value is consumed, without ordering any other memory access around it
+template <typename T>
+inline void Sink( const T& Value )
+{
+    asm volatile( "" : : "r,m"( Value ) );
+}
+
+#undef BENCHMARK_READ_WRITE
+
+struct BenchmarkStatistics
+{
+    double Min, Median, P90, P99, P999, Max, Mean, StdDev, MAD;
+
+    // Samples must be sorted
+    static auto Percentile( const std::vector<double>& Samples, double Rank )
+    {
+        if( Samples.empty() ) return 0.0;
+        const auto Pos   = Rank * ( Samples.size() - 1 );
+        const auto Lower = static_cast<std::size_t>( Pos );
+        const auto Upper = std::min( Lower + 1, Samples.size() - 1 );
+        return Samples[ Lower ] + ( Samples[ Upper ] - Samples[ Lower ] ) * ( Pos - Lower );
+    }
+
+    // two sided 95% quantile of Student's t distribution
+    static auto StudentT975( std::size_t DegreesOfFreedom )
+    {
+        constexpr double Table[] = { 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+                                     2.262,  2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+                                     2.110,  2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+                                     2.060,  2.056, 2.052, 2.048, 2.045, 2.042 };
+        if( DegreesOfFreedom == 0 ) return std::numeric_limits<double>::infinity();
+        if( DegreesOfFreedom <= std::size( Table ) ) return Table[ DegreesOfFreedom - 1 ];
+        return 1.96 + 2.4 / DegreesOfFreedom;
+    }
+
+    static auto MeanVariance( const std::vector<double>& Values )
+    {
+        auto Mean = 0.0, Variance = 0.0;
+        for( auto Value : Values ) Mean += Value;
+        Mean /= std::max( Values.size(), std::size_t{ 1 } );
+        for( auto Value : Values ) Variance += ( Value - Mean ) * ( Value - Mean );
+        Variance /= std::max( Values.size(), std::size_t{ 2 } ) - 1;
+        return std::pair{ Mean, Variance };
+    }
+
+    struct Moments
+    {
+        double Mean, Variance;
+        std::size_t Count;
+    };
+
+    static auto MomentsOf( const std::vector<double>& Values )
+    {
+        const auto [ Mean, Variance ] = MeanVariance( Values );
+        return Moments{ Mean, Variance, Values.size() };
+    }
+
+    // half width of the t-based 95% confidence interval of the mean
+    static auto ConfidenceInterval( const Moments& Values )
+    {
+        if( Values.Count < 2 ) return 0.0;
+        return StudentT975( Values.Count - 1 ) * std::sqrt( Values.Variance / Values.Count );
+    }
+
+    static auto ConfidenceInterval( const std::vector<double>& Values )
+    {
+        return ConfidenceInterval( MomentsOf( Values ) );
+    }
+
+    // Welch's t-test at the 5% level
+    static auto DifferSignificantly( const Moments& A, const Moments& B )
+    {
+        if( A.Count < 2 || B.Count < 2 ) return false;
+        const auto SA = A.Variance / A.Count, SB = B.Variance / B.Count;
+        if( SA + SB == 0 ) return A.Mean != B.Mean;
+        const auto T = std::abs( A.Mean - B.Mean ) / std::sqrt( SA + SB );
+        const auto DegreesOfFreedom =
+        ( SA + SB ) * ( SA + SB ) / ( SA * SA / ( A.Count - 1 ) + SB * SB / ( B.Count - 1 ) );
+        return T > StudentT975( std::max( static_cast<std::size_t>( DegreesOfFreedom ),  //
+                                          std::size_t{ 1 } ) );
+    }
+
+    static auto DifferSignificantly( const std::vector<double>& A, const std::vector<double>& B )
+    {
+        return DifferSignificantly( MomentsOf( A ), MomentsOf( B ) );
+    }
+
+    // two-sided p-value of the Mann-Whitney U test, normal approximation with tie correction
+    static auto MannWhitney( const std::vector<double>& A, const std::vector<double>& B )
+    {
+        if( A.empty() || B.empty() ) return 1.0;
+        auto Pooled = std::vector<std::pair<double, bool>>{};  // value, drawn from A
+        Pooled.reserve( A.size() + B.size() );
+        for( auto Value : A ) Pooled.emplace_back( Value, true );
+        for( auto Value : B ) Pooled.emplace_back( Value, false );
+        std::sort( Pooled.begin(), Pooled.end() );
+
+        auto RankSumA = 0.0, TieCorrection = 0.0;
+        for( auto First = std::size_t{ 0 }; First < Pooled.size(); )
+        {
+            auto Last = First;
+            while( Last < Pooled.size() && Pooled[ Last ].first == Pooled[ First ].first ) ++Last;
+            const auto Rank = ( First + 1 + Last ) / 2.0;  // ties share the mean of their ranks
+            for( auto i = First; i < Last; ++i )
+                if( Pooled[ i ].second ) RankSumA += Rank;
+            const auto Ties = 1.0 * ( Last - First );
+            TieCorrection += Ties * Ties * Ties - Ties;
+            First = Last;
+        }
+
+        const auto NA = 1.0 * A.size(), NB = 1.0 * B.size(), N = NA + NB;
+        const auto U        = RankSumA - NA * ( NA + 1 ) / 2;
+        const auto Variance = NA * NB / 12 * ( N + 1 - TieCorrection / ( N * ( N - 1 ) ) );
+        if( Variance <= 0 ) return 1.0;
+        const auto Z = std::max( std::abs( U - NA * NB / 2 ) - 0.5, 0.0 ) / std::sqrt( Variance );
+        return std::erfc( Z / std::sqrt( 2.0 ) );
+    }
+
+    static auto From( std::vector<double> Samples )
+    {
+        auto Stats = BenchmarkStatistics{};
+        if( Samples.empty() ) return Stats;
+
+        std::sort( Samples.begin(), Samples.end() );
+        Stats.Min    = Samples.front();
+        Stats.Median = Percentile( Samples, 0.5 );
+        Stats.P90    = Percentile( Samples, 0.9 );
+        Stats.P99    = Percentile( Samples, 0.99 );
+        Stats.P999   = Percentile( Samples, 0.999 );
+        Stats.Max    = Samples.back();
+
+        for( auto Sample : Samples ) Stats.Mean += Sample;
+        Stats.Mean /= Samples.size();
+        for( auto Sample : Samples ) Stats.StdDev += std::pow( Sample - Stats.Mean, 2 );
+        Stats.StdDev = Samples.size() > 1 ? std::sqrt( Stats.StdDev / ( Samples.size() - 1 ) ) : 0.0;
+
+        for( auto& Sample : Samples ) Sample = std::abs( Sample - Stats.Median );
+        std::sort( Samples.begin(), Samples.end() );
+        Stats.MAD = Percentile( Samples, 0.5 );
+        return Stats;
+    }
+};
+
+// latencies in log-linear buckets : every power of two is split into SubBuckets equal parts, so
+// a value is known to Digits significant digits whatever its magnitude. The buckets of a power of
+// two are allocated when a value first lands in it, recording never searches, and histograms of
+// the same precision merge by adding their buckets
+struct BenchmarkHistogram
+{
+    constexpr static auto Header      = std::string_view{ "benchmark-histogram 1" };
+    constexpr static auto MinExponent = -16;  // smaller values share the first bucket
+    constexpr static auto MaxExponent = 48;   // larger values share the last bucket
+
+    int Digits;
+    std::size_t SubBuckets;
+    std::vector<std::vector<std::uint64_t>> Rows;  // SubBuckets per exponent, or none yet
+    std::uint64_t Total;
+    double Min, Max, Average, M2;  // exact, M2 sums the squared deviations from Average
+
+    explicit BenchmarkHistogram( int SignificantDigits = 3 )
+        : Digits{ std::clamp( SignificantDigits, 1, 4 ) },
+          SubBuckets{ std::bit_ceil( static_cast<std::size_t>( std::pow( 10, Digits ) ) ) },
+          Rows( MaxExponent - MinExponent + 1 ),
+          Total{ 0 },
+          Min{ std::numeric_limits<double>::infinity() },
+          Max{ 0 },
+          Average{ 0 },
+          M2{ 0 }
+    {}
+
+    auto Index( double Value ) const noexcept -> std::size_t
+    {
+        if( ! ( Value > 0 ) ) return 0;
+        auto Exponent       = 0;
+        const auto Mantissa = std::frexp( Value, &Exponent );  // in [0.5, 1)
+        if( Exponent < MinExponent ) return 0;
+        if( Exponent > MaxExponent ) return Rows.size() * SubBuckets - 1;
+        const auto Sub = static_cast<std::size_t>( ( Mantissa - 0.5 ) * 2 * SubBuckets );
+        return ( Exponent - MinExponent ) * SubBuckets + std::min( Sub, SubBuckets - 1 );
+    }
+
+    // middle of the bucket
+    auto Value( std::size_t Index ) const
+    {
+        const auto Exponent = static_cast<int>( Index / SubBuckets ) + MinExponent;
+        const auto Sub      = 1.0 * ( Index % SubBuckets );
+        return std::ldexp( 0.5 + ( Sub + 0.5 ) / ( 2 * SubBuckets ), Exponent );
+    }
+
+    auto& Bucket( std::size_t Index )
+    {
+        auto& Row = Rows[ Index / SubBuckets ];
+        if( Row.empty() ) Row.resize( SubBuckets );
+        return Row[ Index % SubBuckets ];
+    }
+
+    // whether recording Value would allocate its row of buckets
+    auto Allocates( double Value ) const { return Rows[ Index( Value ) / SubBuckets ].empty(); }
+
+    // calls Visitor( Index, Count ) for every bucket holding a value, in increasing order,
+    // until it returns true
+    auto Scan( auto&& Visitor ) const
+    {
+        for( auto Row = std::size_t{ 0 }; Row < Rows.size(); ++Row )
+            for( auto Sub = std::size_t{ 0 }; Sub < Rows[ Row ].size(); ++Sub )
+                if( Rows[ Row ][ Sub ] && Visitor( Row * SubBuckets + Sub, Rows[ Row ][ Sub ] ) )
+                    return true;
+        return false;
+    }
+
+    auto Record( double Value, std::uint64_t Count = 1 )
+    {
+        if( Count == 0 ) return;
+        Bucket( Index( Value ) ) += Count;
+        Total += Count;
+        Min = std::min( Min, Value );
+        Max = std::max( Max, Value );
+        const auto Delta = Value - Average;
+        Average += Delta * Count / Total;
+        M2 += Delta * ( Value - Average ) * Count;
+    }
+
+    // false, and nothing merged, when the precisions differ
+    auto Merge( const BenchmarkHistogram& Other )
+    {
+        if( Other.Digits != Digits ) return false;
+        if( Other.Total == 0 ) return true;
+        Other.Scan( [ & ]( std::size_t Index, std::uint64_t Count ) {
+            Bucket( Index ) += Count;
+            return false;
+        } );
+        const auto Delta = Other.Average - Average;
+        const auto Sum   = Total + Other.Total;
+        M2 += Other.M2 + Delta * Delta * Total * Other.Total / Sum;
+        Average += Delta * Other.Total / Sum;
+        Total = Sum;
+        Min   = std::min( Min, Other.Min );
+        Max   = std::max( Max, Other.Max );
+        return true;
+    }
+
+    auto Variance() const { return Total > 1 ? std::max( M2 / ( Total - 1 ), 0.0 ) : 0.0; }
+
+    // calls Visitor( Value, Count ) for every bucket holding a value, in increasing order
+    auto Visit( auto&& Visitor ) const
+    {
+        Scan( [ & ]( std::size_t Index, std::uint64_t Count ) {
+            Visitor( std::clamp( Value( Index ), Min, Max ), Count );
+            return false;
+        } );
+    }
+
+    auto Percentile( double Rank ) const
+    {
+        if( Total == 0 ) return 0.0;
+        const auto Target =
+        std::max( static_cast<std::uint64_t>( std::ceil( Rank * Total ) ), std::uint64_t{ 1 } );
+        auto Seen  = std::uint64_t{ 0 };
+        auto Found = Max;
+        Scan( [ & ]( std::size_t Index, std::uint64_t Count ) {
+            if( ( Seen += Count ) < Target ) return false;
+            Found = std::clamp( Value( Index ), Min, Max );
+            return true;
+        } );
+        return Found;
+    }
+
+    // Scale converts the recorded unit, the median absolute deviation is taken bucket by bucket
+    auto Statistics( double Scale = 1.0 ) const
+    {
+        auto Stats = BenchmarkStatistics{};
+        if( Total == 0 ) return Stats;
+        const auto Median = Percentile( 0.5 );
+        auto Deviations   = std::vector<std::pair<double, std::uint64_t>>{};
+        Visit( [ & ]( double Value, std::uint64_t Count ) {
+            Deviations.emplace_back( std::abs( Value - Median ), Count );
+        } );
+        std::sort( Deviations.begin(), Deviations.end() );
+        auto MAD = 0.0, Seen = 0.0;
+        for( auto [ Deviation, Count ] : Deviations )
+        {
+            MAD = Deviation;
+            if( ( Seen += Count ) >= Total / 2.0 ) break;
+        }
+
+        Stats.Min    = Min * Scale;
+        Stats.Median = Median * Scale;
+        Stats.P90    = Percentile( 0.9 ) * Scale;
+        Stats.P99    = Percentile( 0.99 ) * Scale;
+        Stats.P999   = Percentile( 0.999 ) * Scale;
+        Stats.Max    = Max * Scale;
+        Stats.Mean   = Average * Scale;
+        Stats.StdDev = std::sqrt( Variance() ) * Scale;
+        Stats.MAD    = MAD * Scale;
+        return Stats;
+    }
+
+    // one line : the header, precision and exact moments, then index and count of every
+    // bucket holding a value
+    auto Save( std::ostream& Out ) const
+    {
+        auto Buckets = std::size_t{ 0 };
+        Scan( [ & ]( std::size_t, std::uint64_t ) { return ++Buckets, false; } );
+        Out << Header << ' ' << Digits << ' ' << Total << std::setprecision( 17 ) << ' ' << Min
+            << ' ' << Max << ' ' << Average << ' ' << M2 << ' ' << Buckets;
+        Scan( [ & ]( std::size_t Index, std::uint64_t Count ) {
+            Out << ' ' << Index << ' ' << Count;
+            return false;
+        } );
+        return static_cast<bool>( Out );
+    }
+
+    static auto Load( std::istream& In )
+    {
+        auto Fields = std::istringstream{};
+        auto Line   = std::string{};
+        if( ! std::getline( In, Line ) || ! Line.starts_with( Header ) )
+            return std::optional<BenchmarkHistogram>{};
+        Fields.str( Line.substr( Header.size() ) );
+
+        auto Digits  = 0;
+        auto Buckets = std::size_t{ 0 };
+        Fields >> Digits;
+        auto Histogram = BenchmarkHistogram{ Digits };
+        Fields >> Histogram.Total >> Histogram.Min >> Histogram.Max >> Histogram.Average  //
+        >> Histogram.M2 >> Buckets;
+        for( auto Index = std::size_t{ 0 }; Buckets-- && Fields >> Index; )
+            if( Index >= Histogram.Rows.size() * Histogram.SubBuckets ||
+                ! ( Fields >> Histogram.Bucket( Index ) ) )
+                Fields.setstate( std::ios::failbit );
+        if( ! Fields || Histogram.Digits != Digits ) return std::optional<BenchmarkHistogram>{};
+        return std::optional{ std::move( Histogram ) };
+    }
+};
 
-        auto cout_line = [ cout_row ] {
-            cout_row( "", "", "", "", '_' );
-            std::cout << '\n';
+// hardware counters of the calling thread over the measured region, opened as one group
+// so that they are scheduled together. Events that cannot be opened are left out,
+// all of them when perf_event_open is not permitted ( perf_event_paranoid, containers )
+struct BenchmarkCounters
+{
+    constexpr static auto Count = std::size_t{ 7 };
+    constexpr static auto Names = std::array<std::string_view, Count>{
+    "Instr", "Cycles", "CacheRef", "CacheMiss", "BrMiss", "L1dMiss", "dTLBMiss" };
+
+    std::array<int, Count> Descriptors;
+    std::size_t Opened;  // events in the group, in the order they were opened
+    std::array<std::size_t, Count> Order;
+
+#if defined( __linux__ )
+    static auto Attribute( std::size_t Event )
+    {
+        constexpr auto CacheMiss = []( std::uint64_t Cache ) {
+            return Cache | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
         };
+        constexpr std::pair<std::uint32_t, std::uint64_t> Events[ Count ] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        { PERF_TYPE_HW_CACHE, CacheMiss( PERF_COUNT_HW_CACHE_L1D ) },
+        { PERF_TYPE_HW_CACHE, CacheMiss( PERF_COUNT_HW_CACHE_DTLB ) } };
+
+        auto Attr           = perf_event_attr{};
+        Attr.size           = sizeof( Attr );
+        Attr.type           = Events[ Event ].first;
+        Attr.config         = Events[ Event ].second;
+        Attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |  //
+                              PERF_FORMAT_TOTAL_TIME_RUNNING;
+        Attr.exclude_kernel = 1;
+        Attr.exclude_hv     = 1;
+        return Attr;
+    }
+
+    auto Leader() const { return Opened ? Descriptors[ Order[ 0 ] ] : -1; }
+
+    // only the leader starts disabled, the rest follow it
+    explicit BenchmarkCounters( bool Enable ) : Descriptors{}, Opened{ 0 }, Order{}
+    {
+        Descriptors.fill( -1 );
+        for( auto Event = std::size_t{ 0 }; Enable && Event < Count; ++Event )
+        {
+            auto Attr     = Attribute( Event );
+            Attr.disabled = Opened == 0;
+            const auto Descriptor =
+            static_cast<int>( syscall( SYS_perf_event_open, &Attr, 0, -1, Leader(), 0 ) );
+            if( Descriptor < 0 ) continue;
+            Descriptors[ Event ] = Descriptor;
+            Order[ Opened++ ]    = Event;
+        }
+        if( Opened ) ioctl( Leader(), PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+    }
+
+    ~BenchmarkCounters()
+    {
+        for( auto Descriptor : Descriptors )
+            if( Descriptor >= 0 ) close( Descriptor );
+    }
+
+    auto Start() const
+    {
+        if( Opened ) ioctl( Leader(), PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+    }
+
+    auto Stop() const
+    {
+        if( Opened ) ioctl( Leader(), PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP );
+    }
+
+    // totals since construction, scaled up when the group was multiplexed,
+    // and a mask of the events that were counted
+    auto Read() const
+    {
+        auto Totals = std::array<double, Count>{};
+        auto Mask   = 0u;
+        std::uint64_t Buffer[ 3 + Count ] = {};
+        if( Opened == 0 || read( Leader(), Buffer, sizeof( Buffer ) ) <= 0 || Buffer[ 2 ] == 0 )
+            return std::pair{ Totals, Mask };
+
+        const auto Scale = 1.0 * Buffer[ 1 ] / Buffer[ 2 ];
+        for( auto i = std::size_t{ 0 }; i < std::min<std::size_t>( Opened, Buffer[ 0 ] ); ++i )
+        {
+            Totals[ Order[ i ] ] = Buffer[ 3 + i ] * Scale;
+            Mask |= 1u << Order[ i ];
+        }
+        return std::pair{ Totals, Mask };
+    }
+#else
+    explicit BenchmarkCounters( bool ) : Descriptors{}, Opened{ 0 }, Order{} {}
+    auto Start() const {}
+    auto Stop() const {}
+    auto Read() const { return std::pair{ std::array<double, Count>{}, 0u }; }
+#endif
+
+    BenchmarkCounters( const BenchmarkCounters& )            = delete;
+    BenchmarkCounters& operator=( const BenchmarkCounters& ) = delete;
+};
+
+// what the operating system accounts to the calling thread : CPU time in user and kernel mode,
+// voluntary and involuntary context switches and page faults from getrusage, and the time spent
+// waiting on a run queue from schedstat. Two snapshots give the usage in between
+struct BenchmarkResourceUsage
+{
+    constexpr static auto Count = std::size_t{ 7 };
+    constexpr static auto Names = std::array<std::string_view, Count>{
+    "User(ns)", "System(ns)", "VolCS", "InvolCS", "MinFlt", "MajFlt", "RunQueue(ns)" };
+    constexpr static auto Keys = std::array<std::string_view, Count>{
+    "user_ns",      "system_ns",    "voluntary_switches", "involuntary_switches",
+    "minor_faults", "major_faults", "run_queue_ns" };
+
+    std::array<double, Count> Values{};
+
+    static auto Snapshot()
+    {
+        auto Usage = BenchmarkResourceUsage{};
+#if defined( __linux__ )
+        auto Accounted   = rusage{};
+        auto Nanoseconds = []( timeval Time ) { return Time.tv_sec * 1e9 + Time.tv_usec * 1e3; };
+        if( getrusage( RUSAGE_THREAD, &Accounted ) == 0 )
+            Usage.Values = { Nanoseconds( Accounted.ru_utime ), Nanoseconds( Accounted.ru_stime ),
+                             1.0 * Accounted.ru_nvcsw,           1.0 * Accounted.ru_nivcsw,
+                             1.0 * Accounted.ru_minflt,          1.0 * Accounted.ru_majflt,
+                             0.0 };
+
+        // time on the CPU, then time waiting for it, in ns
+        auto Schedstat = std::ifstream{ "/proc/thread-self/schedstat" };
+        auto Running   = 0.0;
+        Schedstat >> Running >> Usage.Values[ 6 ];
+#endif
+        return Usage;
+    }
+
+    auto operator-( const BenchmarkResourceUsage& Start ) const
+    {
+        auto Difference = *this;
+        for( auto i = std::size_t{ 0 }; i < Count; ++i ) Difference.Values[ i ] -= Start.Values[ i ];
+        return Difference;
+    }
+
+    auto& operator+=( const BenchmarkResourceUsage& Other )
+    {
+        for( auto i = std::size_t{ 0 }; i < Count; ++i ) Values[ i ] += Other.Values[ i ];
+        return *this;
+    }
+};
+
+// time between PauseTiming() and ResumeTiming() is taken out of the running batch,
+// together with the calibrated cost of the pair that stays inside the timed region
+struct BenchmarkPause
+{
+    std::uint64_t Start;
+    std::uint64_t Total;  // paused cycles of the running batch
+    std::size_t Count;    // pauses of the running batch
+
+    static auto& Current()
+    {
+        thread_local constinit auto State = BenchmarkPause{};
+        return State;
+    }
+
+    static auto Pause() { Current().Start = TscTimer::Stop(); }
+
+    static auto Resume()
+    {
+        auto& State = Current();
+        State.Total += TscTimer::Start() - State.Start;
+        ++State.Count;
+    }
+
+    // cycles per pause / resume pair, best of a few runs
+    static auto Overhead()
+    {
+        static const auto Cost = [] {
+            constexpr auto Pairs = 256;
+            auto Best            = std::numeric_limits<double>::max();
+            for( auto Round = 0; Round < 16; ++Round )
+            {
+                Current()        = {};
+                const auto Start = TscTimer::Start();
+                for( auto i = 0; i < Pairs; ++i )
+                {
+                    Pause();
+                    Resume();
+                }
+                const auto Stop = TscTimer::Stop();
+                Best            = std::min( Best, 1.0 * ( Stop - Start - Current().Total ) / Pairs );
+            }
+            Current() = {};
+            return std::max( Best, 0.0 );
+        }();
+        return Cost;
+    }
+
+    // paused cycles of the running batch, never more than the batch itself
+    static auto Take( std::uint64_t Span )
+    {
+        auto& State       = Current();
+        const auto Paused = State.Total + static_cast<std::uint64_t>( State.Count * Overhead() );
+        State.Total = State.Count = 0;
+        return std::min( Paused, Span );
+    }
+};
+
+auto PauseTiming() { BenchmarkPause::Pause(); }
+auto ResumeTiming() { BenchmarkPause::Resume(); }
+
+// heap activity of the calling thread while it measures, fed by the replacement
+// operator new / delete compiled in with BENCHMARK_TRACK_ALLOCATIONS
+struct BenchmarkAllocations
+{
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+    constexpr static auto Enabled = true;
+#else
+    constexpr static auto Enabled = false;
+#endif
+
+    std::size_t Count;
+    std::size_t Bytes;
+    std::int64_t Live;  // above where tracking started
+    std::int64_t Peak;
+    bool Tracking;
+
+    static auto& Current()
+    {
+        thread_local constinit auto State = BenchmarkAllocations{};
+        return State;
+    }
+
+    auto Allocated( std::size_t Size )
+    {
+        if( ! Tracking ) return;
+        ++Count;
+        Bytes += Size;
+        Live += Size;
+        Peak = std::max( Peak, Live );
+    }
+
+    auto Freed( std::size_t Size )
+    {
+        if( Tracking ) Live -= Size;
+    }
+};
+
+// bytes and items the body declares as it goes, for bodies whose size varies
+struct BenchmarkProcessed
+{
+    double Bytes;
+    double Items;
+
+    static auto& Current()
+    {
+        thread_local constinit auto State = BenchmarkProcessed{};
+        return State;
+    }
+};
+
+inline auto AddBytesProcessed( double Bytes ) { BenchmarkProcessed::Current().Bytes += Bytes; }
+inline auto AddItemsProcessed( double Items ) { BenchmarkProcessed::Current().Items += Items; }
+
+// what Throughput and the Relative column count per second
+enum class BenchmarkUnit : unsigned char { Iterations, Bytes, Items };
+
+// Warm runs iterations back to back. Cold evicts the caches after every iteration, outside the
+// timed region, to expose the first-touch cost
+enum class BenchmarkCacheMode : unsigned char { Default, Warm, Cold };
+
+// flushes the registered regions line by line (x86 only), or without any, reads through a
+// buffer twice the size of the last-level cache
+struct BenchmarkCache
+{
+    constexpr static auto LineSize = std::size_t{ 64 };
+
+    static auto& Regions()
+    {
+        static auto List = std::vector<std::pair<const char*, std::size_t>>{};
+        return List;
+    }
+
+    static auto Register( const void* Data, std::size_t Bytes )
+    {
+        Regions().emplace_back( static_cast<const char*>( Data ), Bytes );
+    }
+
+    static auto Unregister() { Regions().clear(); }
+
+    // largest cache that cpu0 reports, 32 MiB when unknown
+    static auto LastLevelSize()
+    {
+        auto Largest = std::size_t{ 0 };
+#if defined( __linux__ )
+        for( auto Index = 0; Index < 8; ++Index )
+        {
+            auto Size   = std::size_t{ 0 };
+            auto Suffix = char{};
+            auto Path   = "/sys/devices/system/cpu/cpu0/cache/index" + std::to_string( Index );
+            if( ! ( std::ifstream{ Path + "/size" } >> Size >> Suffix ) ) continue;
+            Size <<= Suffix == 'K' ? 10 : Suffix == 'M' ? 20 : 0;
+            Largest = std::max( Largest, Size );
+        }
+#endif
+        return Largest ? Largest : std::size_t{ 32 } << 20;
+    }
+
+    static auto& Buffer()
+    {
+        static auto Lines = std::vector<unsigned char>( 2 * LastLevelSize(), 1 );
+        return Lines;
+    }
+
+    // untimed by the caller, see BasicBenchmarkContainer::Iterator::NextBatch
+    static auto Evict()
+    {
+#if defined( __x86_64__ ) || defined( __i386__ )
+        for( auto [ Data, Bytes ] : Regions() )
+            for( auto Offset = std::size_t{ 0 }; Offset < Bytes; Offset += LineSize )
+                _mm_clflush( Data + Offset );
+        _mm_mfence();
+        if( Regions().empty() )
+#endif
+        {
+            const auto& Lines = Buffer();
+            auto Sum          = 0u;
+            for( auto i = std::size_t{ 0 }; i < Lines.size(); i += LineSize ) Sum += Lines[ i ];
+            Sink( Sum );
+        }
+    }
+};
+
+struct BenchmarkRepetition
+{
+    std::size_t TotalCycle;
+    std::size_t TotalIteration;
+    bool Outlier;
+    auto Latency() const
+    {
+        return TotalIteration ? TscTimer::ToNanoseconds( 1.0 * TotalCycle / TotalIteration ) : 0.0;
+    }
+};
+
+struct BenchmarkResult
+{
+    std::string Title;
+    std::size_t TotalCycle{};  // over every repetition that is not an outlier
+    std::size_t TotalIteration{};
+    std::vector<double> Samples{};  // cycles per iteration, one per batch
+    std::optional<BenchmarkHistogram> Histogram{};  // holds the batches instead, when enabled
+    std::size_t WarmupIteration{};
+    std::vector<BenchmarkRepetition> Repetitions{};
+    std::string Family{};  // title shared by every point of a sweep
+    std::vector<std::int64_t> Args{};
+    std::size_t Threads{};  // threaded mode only, totals then add up every thread
+    std::array<double, BenchmarkCounters::Count> Counters{};  // totals over every repetition
+    unsigned CounterMask{};                                  // which of them were counted
+    BenchmarkResourceUsage Resources{};  // totals over every repetition, when accounted
+    std::size_t MeasuredIteration{};  // over every repetition, outliers included
+    std::size_t AllocationCount{};
+    std::size_t AllocationBytes{};
+    std::int64_t PeakBytes{};
+    BenchmarkCacheMode Cache{};
+    std::size_t InFlight{};            // async mode only
+    std::vector<double> Completions{};  // async mode only, cycles from submission to resumption
+    double OfferedRate{};              // open-loop mode only, operations per second
+    double BytesProcessed{};  // over every measured iteration, outliers included
+    double ItemsProcessed{};  // likewise
+    auto Cycle() const { return TotalIteration ? 1.0 * TotalCycle / TotalIteration : 0.0; }
+    auto Latency() const { return TscTimer::ToNanoseconds( Cycle() ); }
+    auto Throughput() const
+    {
+        return TotalCycle ? std::max( Threads, std::size_t{ 1 } ) * 1e9 / Latency() : 0.0;
+    }
+    auto operator<( const auto& RHS ) const { return Title.length() < RHS.Title.length(); }
+
+    // per iteration, zero unless the body declared them
+    auto BytesPerIteration() const
+    {
+        return BytesProcessed / std::max( MeasuredIteration, std::size_t{ 1 } );
+    }
+    auto ItemsPerIteration() const
+    {
+        return ItemsProcessed / std::max( MeasuredIteration, std::size_t{ 1 } );
+    }
+
+    // per second
+    auto Rate( BenchmarkUnit Unit ) const
+    {
+        switch( Unit )
+        {
+            case BenchmarkUnit::Bytes : return Throughput() * BytesPerIteration();
+            case BenchmarkUnit::Items : return Throughput() * ItemsPerIteration();
+            default : return Throughput();
+        }
+    }
+
+    auto ItemLatency() const
+    {
+        return ItemsProcessed > 0 ? Latency() / ItemsPerIteration() : 0.0;
+    }
+
+    // per iteration, zero unless built with BENCHMARK_TRACK_ALLOCATIONS
+    auto Allocations() const
+    {
+        return 1.0 * AllocationCount / std::max( MeasuredIteration, std::size_t{ 1 } );
+    }
+    auto AllocatedBytes() const
+    {
+        return 1.0 * AllocationBytes / std::max( MeasuredIteration, std::size_t{ 1 } );
+    }
+
+    // in nanoseconds
+    auto SampleLatencies() const
+    {
+        auto Latencies = std::vector<double>( Samples.size() );
+        std::transform( Samples.begin(), Samples.end(), Latencies.begin(), TscTimer::ToNanoseconds );
+        return Latencies;
+    }
+
+    auto Statistics() const
+    {
+        if( Histogram ) return Histogram->Statistics( TscTimer::ToNanoseconds( 1.0 ) );
+        return BenchmarkStatistics::From( SampleLatencies() );
+    }
+
+    auto CompletionStatistics() const
+    {
+        auto Latencies = std::vector<double>( Completions.size() );
+        std::transform( Completions.begin(), Completions.end(), Latencies.begin(),
+                        TscTimer::ToNanoseconds );
+        return BenchmarkStatistics::From( std::move( Latencies ) );
+    }
+
+    auto RejectedRepetitions() const
+    {
+        return std::count_if( Repetitions.begin(), Repetitions.end(),  //
+                              []( auto&& Repetition ) { return Repetition.Outlier; } );
+    }
+
+    // per repetition when there are several, per batch otherwise
+    auto Observations() const
+    {
+        if( Repetitions.size() - RejectedRepetitions() < 2 ) return SampleLatencies();
+        auto Latencies = std::vector<double>{};
+        for( auto&& Repetition : Repetitions )
+            if( ! Repetition.Outlier ) Latencies.push_back( Repetition.Latency() );
+        return Latencies;
+    }
+
+    // of Observations(), taken from the histogram when batches were not kept
+    auto ObservationMoments() const
+    {
+        if( ! Histogram || Repetitions.size() - RejectedRepetitions() >= 2 )
+            return BenchmarkStatistics::MomentsOf( Observations() );
+        const auto Scale = TscTimer::ToNanoseconds( 1.0 );
+        return BenchmarkStatistics::Moments{ Histogram->Average * Scale,
+                                             Histogram->Variance() * Scale * Scale,
+                                             static_cast<std::size_t>( Histogram->Total ) };
+    }
+
+    // false for rows that kept nothing to take a spread from, see BenchmarkStoreNothing
+    auto Observed() const
+    {
+        return ! Samples.empty() || ( Histogram && Histogram->Total > 0 ) ||
+               Repetitions.size() - RejectedRepetitions() >= 2;
+    }
+
+    // NaN without observations
+    auto ConfidenceInterval() const
+    {
+        if( ! Observed() ) return std::numeric_limits<double>::quiet_NaN();
+        return BenchmarkStatistics::ConfidenceInterval( ObservationMoments() );
+    }
+
+    // Tukey fences reject outlier repetitions, the rest make up the result
+    auto Aggregate()
+    {
+        if( Repetitions.size() >= 4 )
+        {
+            auto Latencies = std::vector<double>{};
+            for( auto&& Repetition : Repetitions ) Latencies.push_back( Repetition.Latency() );
+            std::sort( Latencies.begin(), Latencies.end() );
+            const auto Q1  = BenchmarkStatistics::Percentile( Latencies, 0.25 );
+            const auto Q3  = BenchmarkStatistics::Percentile( Latencies, 0.75 );
+            const auto IQR = Q3 - Q1;
+            for( auto&& Repetition : Repetitions )
+                Repetition.Outlier = Repetition.Latency() < Q1 - 1.5 * IQR ||  //
+                                     Repetition.Latency() > Q3 + 1.5 * IQR;
+        }
+
+        TotalCycle = TotalIteration = 0;
+        for( auto&& Repetition : Repetitions )
+            if( ! Repetition.Outlier )
+            {
+                TotalCycle += Repetition.TotalCycle;
+                TotalIteration += Repetition.TotalIteration;
+            }
+    }
+};
+
+struct BenchmarkComplexity
+{
+    std::string_view Name;
+    double Coefficient;
+    double RMS;  // relative to the mean latency
+
+    // least squares fit of Latency = Coefficient * f(N) for every f, the smallest RMS wins
+    static auto Fit( const std::vector<std::pair<double, double>>& Points )
+    {
+        constexpr std::pair<std::string_view, double ( * )( double )> Models[] = {
+        { "O(1)", []( double ) { return 1.0; } },
+        { "O(log n)", []( double N ) { return std::log2( std::max( N, 2.0 ) ); } },
+        { "O(n)", []( double N ) { return N; } },
+        { "O(n log n)", []( double N ) { return N * std::log2( std::max( N, 2.0 ) ); } },
+        { "O(n^2)", []( double N ) { return N * N; } } };
+
+        auto MeanLatency = 0.0;
+        for( auto [ N, Latency ] : Points ) MeanLatency += Latency / Points.size();
+
+        auto Best = BenchmarkComplexity{ "-", 0, std::numeric_limits<double>::infinity() };
+        for( auto [ Name, F ] : Models )
+        {
+            auto FT = 0.0, FF = 0.0;
+            for( auto [ N, Latency ] : Points ) FT += F( N ) * Latency, FF += F( N ) * F( N );
+            const auto Coefficient = FT / FF;
+
+            auto Residual = 0.0;
+            for( auto [ N, Latency ] : Points )
+                Residual += std::pow( Latency - Coefficient * F( N ), 2 );
+            const auto RMS = std::sqrt( Residual / Points.size() ) / MeanLatency;
+            if( RMS < Best.RMS ) Best = { Name, Coefficient, RMS };
+        }
+        return Best;
+    }
+};
+
+// results of an earlier run, kept as text : a header line, then per benchmark its title
+// on one line and its latency, iteration count and per batch samples on the next, all in ns
+struct BenchmarkBaseline
+{
+    constexpr static auto Header       = std::string_view{ "benchmark-baseline 1" };
+    constexpr static auto Significance = 0.05;
+    constexpr static auto Quantiles    = std::uint64_t{ 1000 };
+
+    std::string Title;
+    double Latency;
+    std::size_t TotalIteration;
+    std::vector<double> Samples;
+
+    // per batch, or evenly spaced quantiles standing for them when only a histogram was kept
+    static auto Latencies( const BenchmarkResult& Result )
+    {
+        if( ! Result.Histogram ) return Result.SampleLatencies();
+        auto Latencies = std::vector<double>( std::min( Result.Histogram->Total, Quantiles ) );
+        for( auto i = std::size_t{ 0 }; i < Latencies.size(); ++i )
+            Latencies[ i ] = TscTimer::ToNanoseconds(
+            Result.Histogram->Percentile( ( i + 0.5 ) / Latencies.size() ) );
+        return Latencies;
+    }
+
+    static auto Save( const std::vector<BenchmarkResult>& Results, const std::string& Path )
+    {
+        auto File = std::ofstream{ Path };
+        if( ! File ) return false;
+        File << Header << '\n' << std::setprecision( 9 );
+        for( auto&& Result : Results )
+        {
+            const auto Samples = Latencies( Result );
+            File << Result.Title.substr( 1 ) << '\n'
+                 << Result.Latency() << ' ' << Result.TotalIteration << ' ' << Samples.size();
+            for( auto Sample : Samples ) File << ' ' << Sample;
+            File << '\n';
+        }
+        return static_cast<bool>( File );
+    }
+
+    static auto Load( const std::string& Path )
+    {
+        using Baselines_t = std::vector<BenchmarkBaseline>;
+        auto Baselines    = Baselines_t{};
+        auto File         = std::ifstream{ Path };
+        auto Line         = std::string{};
+        if( ! std::getline( File, Line ) || Line != Header ) return std::optional<Baselines_t>{};
+
+        for( auto Title = std::string{}; std::getline( File, Title ) && std::getline( File, Line ); )
+        {
+            auto Fields    = std::istringstream{ Line };
+            auto& Baseline = Baselines.emplace_back( std::move( Title ), 0.0, std::size_t{ 0 },
+                                                     std::vector<double>{} );
+            auto Count     = std::size_t{ 0 };
+            Fields >> Baseline.Latency >> Baseline.TotalIteration >> Count;
+            Baseline.Samples.resize( Count );
+            for( auto&& Sample : Baseline.Samples ) Fields >> Sample;
+            if( ! Fields ) return std::optional<Baselines_t>{};
+        }
+        return std::optional{ std::move( Baselines ) };
+    }
+
+    // matches benchmarks by title and prints the change of each against the baseline,
+    // true when any of them is significantly slower by more than Threshold
+    static auto Compare( const std::vector<BenchmarkResult>& Results,
+                         const std::vector<BenchmarkBaseline>& Baselines,  //
+                         double Threshold, std::ostream& Out )
+    {
+        const auto Longest    = std::max_element( Results.begin(), Results.end() );
+        const auto TitleWidth = std::max( Longest->Title.length(), std::size_t{ 24 } );
+        auto cout_diff = [ &Out, TW = std::setw( TitleWidth ), SW = std::setw( 12 ) ](  //
+                         std::string_view Title,                                        //
+                         const auto&... Columns )                                       //
+        {
+            Out << std::left << TW << Title << std::right << std::fixed;
+            ( ( Out << SW << std::setprecision( 2 ) << Columns ), ... );
+            Out << '\n';
+        };
+
+        auto Regressed = false;
+        Out << "\n Baseline Comparison (ns, threshold " << std::setprecision( 1 ) << Threshold * 100
+            << "%)\n";
+        cout_diff( "", "Baseline", "Current", "Change(%)", "p-value", "Verdict" );
+        for( auto&& Result : Results )
+        {
+            const auto Baseline = std::find_if( Baselines.begin(), Baselines.end(),  //
+                                                [ & ]( auto&& Entry ) {
+                                                    return Entry.Title == Result.Title.substr( 1 );
+                                                } );
+            if( Baseline == Baselines.end() )
+            {
+                cout_diff( Result.Title, "-", Result.Latency(), "-", "-", "new" );
+                continue;
+            }
+
+            const auto Latency = Result.Latency();
+            const auto Change  = Baseline->Latency > 0 ? Latency / Baseline->Latency - 1 : 0.0;
+            const auto PValue =
+            BenchmarkStatistics::MannWhitney( Latencies( Result ), Baseline->Samples );
+            const auto Significant = PValue < Significance;
+            const auto Verdict     = ! Significant          ? "same"
+                                     : Change > Threshold   ? "regressed"
+                                     : Change < -Threshold  ? "improved"
+                                                            : "within";
+            Regressed |= Significant && Change > Threshold;
+            cout_diff( Result.Title, Baseline->Latency, Latency, Change * 100, PValue, Verdict );
+        }
+        return Regressed;
+    }
+};
+
+// the report header, so that numbers from different machines are not compared blindly
+struct BenchmarkHost
+{
+    std::string Name;
+    std::string Cpu;
+    unsigned Cores;
+    double TscFrequency;
+    std::string Compiler;
+    std::string Flags;  // BENCHMARK_BUILD_FLAGS if defined, otherwise guessed from macros
+    std::string Kernel;
+    std::string Governor;  // cpufreq governor of cpu0
+    std::string Turbo;     // "on", "off" or "unknown", likewise Smt
+    std::string Smt;
+    std::string Date;  // UTC, ISO 8601
+
+    static auto Collect()
+    {
+        auto Host = BenchmarkHost{ "unknown", "unknown", std::thread::hardware_concurrency(),
+                                   TscTimer::Frequency(), "unknown", "", "unknown", "unknown",
+                                   "unknown", "unknown", "" };
+#if defined( __linux__ )
+        char Name[ 256 ] = {};
+        if( gethostname( Name, sizeof( Name ) - 1 ) == 0 ) Host.Name = Name;
+        auto CpuInfo = std::ifstream{ "/proc/cpuinfo" };
+        for( auto Line = std::string{}; std::getline( CpuInfo, Line ); )
+            if( Line.starts_with( "model name" ) && Line.find( ':' ) != Line.npos )
+            {
+                Host.Cpu = Line.substr( Line.find_first_not_of( " \t", Line.find( ':' ) + 1 ) );
+                break;
+            }
+        auto Uname = utsname{};
+        if( uname( &Uname ) == 0 )
+            Host.Kernel = std::string{ Uname.sysname } + " " + Uname.release + " " + Uname.machine;
+
+        auto ReadSysfs = []( const char* Path ) {
+            auto Line = std::string{};
+            std::getline( std::ifstream{ Path }, Line );
+            return Line;
+        };
+        const auto OnOff = []( const std::string& Flag, const char* On, const char* Off ) {
+            return Flag == On ? "on" : Flag == Off ? "off" : "unknown";
+        };
+        if( auto Governor = ReadSysfs( "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor" );
+            ! Governor.empty() )
+            Host.Governor = Governor;
+        // intel_pstate reports the inverse, every other driver goes through cpufreq/boost
+        Host.Turbo =
+        OnOff( ReadSysfs( "/sys/devices/system/cpu/intel_pstate/no_turbo" ), "0", "1" );
+        if( Host.Turbo == "unknown" )
+            Host.Turbo = OnOff( ReadSysfs( "/sys/devices/system/cpu/cpufreq/boost" ), "1", "0" );
+        Host.Smt = OnOff( ReadSysfs( "/sys/devices/system/cpu/smt/active" ), "1", "0" );
+#endif
+#if defined( __clang__ )
+        Host.Compiler = "clang " __clang_version__;
+#elif defined( __GNUC__ )
+        Host.Compiler = "gcc " __VERSION__;
+#elif defined( _MSC_VER )
+        Host.Compiler = "msvc " + std::to_string( _MSC_VER );
+#endif
+#if defined( BENCHMARK_BUILD_FLAGS )
+        Host.Flags = BENCHMARK_BUILD_FLAGS;
+#else
+#if defined( __OPTIMIZE_SIZE__ )
+        Host.Flags += " -Os";
+#elif defined( __OPTIMIZE__ )
+        Host.Flags += " -O";
+#else
+        Host.Flags += " -O0";
+#endif
+#if defined( NDEBUG )
+        Host.Flags += " -DNDEBUG";
+#endif
+#if defined( __FAST_MATH__ )
+        Host.Flags += " -ffast-math";
+#endif
+#if defined( __AVX512F__ )
+        Host.Flags += " -mavx512f";
+#elif defined( __AVX2__ )
+        Host.Flags += " -mavx2";
+#elif defined( __AVX__ )
+        Host.Flags += " -mavx";
+#endif
+#if defined( __SANITIZE_ADDRESS__ )
+        Host.Flags += " -fsanitize=address";
+#endif
+        Host.Flags.erase( 0, 1 );
+#endif
+        const auto Now = std::chrono::system_clock::to_time_t( std::chrono::system_clock::now() );
+        char Date[ 32 ] = {};
+        std::strftime( Date, sizeof( Date ), "%Y-%m-%dT%H:%M:%SZ", std::gmtime( &Now ) );
+        Host.Date = Date;
+        return Host;
+    }
+
+    // reasons the numbers may not reproduce on this machine
+    auto Warnings() const
+    {
+        auto Found = std::vector<std::string>{};
+        if( Governor != "unknown" && Governor != "performance" )
+            Found.push_back( "cpufreq governor is " + Governor + ", not performance" );
+        if( Turbo == "on" ) Found.push_back( "turbo boost is on, the clock follows the load" );
+        if( Smt == "on" ) Found.push_back( "SMT is active, sibling threads share the core" );
+#if ! defined( __OPTIMIZE__ )
+        Found.push_back( "built without optimization" );
+#endif
+        return Found;
+    }
+};
+
+// where and how the benchmarks run. Apply() takes effect once, before the first benchmark,
+// and warns on anything that makes the numbers hard to reproduce
+struct BenchmarkEnvironment
+{
+    int Core;       // -1 leaves the affinity alone, threaded workers take the cores that follow
+    bool Realtime;  // SCHED_FIFO, refused without CAP_SYS_NICE
+    bool Applied;
+
+    static auto& Current()
+    {
+        static auto Environment = BenchmarkEnvironment{ -1, false, false };
+        return Environment;
+    }
+
+    // pins the calling thread to Core + Offset, wrapping around the online cores
+    static auto PinThread( std::size_t Offset = 0 )
+    {
+        const auto Core = Current().Core;
+        if( Core < 0 ) return true;
+#if defined( __linux__ )
+        const auto Cores = std::max( std::thread::hardware_concurrency(), 1u );
+        auto Set         = cpu_set_t{};
+        CPU_ZERO( &Set );
+        CPU_SET( ( Core + Offset ) % Cores, &Set );
+        return sched_setaffinity( 0, sizeof( Set ), &Set ) == 0;
+#else
+        return false;
+#endif
+    }
+
+    // lowest SCHED_FIFO priority, enough to stay ahead of every ordinary thread
+    static auto RaisePriority()
+    {
+#if defined( __linux__ )
+        auto Parameter           = sched_param{};
+        Parameter.sched_priority = sched_get_priority_min( SCHED_FIFO );
+        return sched_setscheduler( 0, SCHED_FIFO, &Parameter ) == 0;
+#else
+        return false;
+#endif
+    }
+
+    static auto Apply()
+    {
+        auto& Environment = Current();
+        if( std::exchange( Environment.Applied, true ) ) return;
+        if( ! PinThread() ) std::clog << "Warning : cannot pin to core " << Environment.Core << "\n";
+        if( Environment.Realtime && ! RaisePriority() )
+            std::clog << "Warning : SCHED_FIFO refused, running at normal priority\n";
+        for( auto&& Warning : BenchmarkHost::Collect().Warnings() )
+            std::clog << "Warning : " << Warning << "\n";
+    }
+};
+
+struct BenchmarkAnalyzer;
+using BenchmarkReporter = std::function<void( const BenchmarkAnalyzer&, std::ostream& )>;
+void ReportConsole( const BenchmarkAnalyzer& Results, std::ostream& Out );
+void ReportJson( const BenchmarkAnalyzer& Results, std::ostream& Out );
+void ReportCsv( const BenchmarkAnalyzer& Results, std::ostream& Out );
+
+struct BenchmarkAnalyzer : std::vector<BenchmarkResult>
+{
+    std::size_t BaselinePos;
+    bool ShowHistogram;
+    bool ShowCounters;  // read before benchmarks run, not only when printing
+    bool ShowResources;  // likewise
+    int HistogramDigits;  // read before benchmarks run, non-zero records into histograms
+    BenchmarkUnit RelativeUnit;  // what the Relative column compares
+    std::vector<std::pair<BenchmarkReporter, std::string>> Reporters;  // empty path for stdout
+    std::vector<BenchmarkReporter> ConsoleSections;  // appended to the console report
+    std::string BaselineSavePath;
+    std::string BaselineComparePath;
+    double RegressionThreshold;  // relative slowdown tolerated against the baseline
+    bool Finished;
+    int ExitStatus;
+    BenchmarkAnalyzer()
+        : std::vector<BenchmarkResult>{},     //
+          BaselinePos{ 0 },                    //
+          ShowHistogram{ false },              //
+          ShowCounters{ false },               //
+          ShowResources{ false },              //
+          HistogramDigits{ 0 },                //
+          RelativeUnit{ BenchmarkUnit::Iterations },  //
+          Reporters{ { ReportConsole, "" } },  //
+          ConsoleSections{},                   //
+          BaselineSavePath{},                  //
+          BaselineComparePath{},               //
+          RegressionThreshold{ 0.05 },         //
+          Finished{ false },                   //
+          ExitStatus{ EXIT_SUCCESS }
+    {
+        reserve( 10 );
+    }
+
+    // of Result against the baseline, in RelativeUnit, NaN when the baseline has none of it
+    auto Relative( const BenchmarkResult& Result ) const
+    {
+        const auto Baseline = ( *this )[ BaselinePos ].Rate( RelativeUnit );
+        return Baseline > 0 ? Result.Rate( RelativeUnit ) / Baseline
+                            : std::numeric_limits<double>::quiet_NaN();
+    }
+
+    static auto FindReporter( std::string_view Format ) -> BenchmarkReporter
+    {
+        if( Format == "console" ) return ReportConsole;
+        if( Format == "json" ) return ReportJson;
+        if( Format == "csv" ) return ReportCsv;
+        return {};
+    }
+
+    // without a path, Format replaces what goes to stdout,
+    // otherwise it is written to Path in addition
+    auto ReportTo( std::string_view Format, std::string Path = {} )
+    {
+        auto Reporter = FindReporter( Format );
+        if( ! Reporter )
+        {
+            std::cerr << "Unknown report format : " << Format << '\n';
+            return false;
+        }
+        if( Path.empty() )
+            std::erase_if( Reporters, []( auto&& Entry ) { return Entry.second.empty(); } );
+        Reporters.emplace_back( std::move( Reporter ), std::move( Path ) );
+        return true;
+    }
+
+    static auto PrintHistogram( const BenchmarkResult& Result, std::ostream& Out )
+    {
+        constexpr auto BinCount = std::size_t{ 16 };
+        constexpr auto BarWidth = std::size_t{ 50 };
+
+        const auto Stats = Result.Statistics();
+        const auto Lower = Stats.Min;
+        const auto Upper = std::max( Stats.P999, Lower );
+        const auto Step  = ( Upper - Lower ) / BinCount;
+
+        // everything past p99.9 lands in the last bin
+        auto Bins = std::vector<std::size_t>( BinCount );
+        auto Add  = [ & ]( double Sample, std::uint64_t Count ) {
+            const auto Latency = TscTimer::ToNanoseconds( Sample );
+            const auto Bin = Step > 0 ? static_cast<std::size_t>( ( Latency - Lower ) / Step ) : 0;
+            Bins[ std::min( Bin, BinCount - 1 ) ] += Count;
+        };
+        if( Result.Histogram ) Result.Histogram->Visit( Add );
+        for( auto Sample : Result.Samples ) Add( Sample, 1 );
+
+        const auto Peak = std::max( *std::max_element( Bins.begin(), Bins.end() ), std::size_t{ 1 } );
+        Out << '\n' << Result.Title << '\n';
+        for( auto i = std::size_t{ 0 }; i < BinCount; ++i )
+            Out << std::setw( 16 ) << std::setprecision( 2 ) << Lower + Step * i << " ns |"
+                << std::left << std::setw( BarWidth )
+                << std::string( Bins[ i ] * BarWidth / Peak, '#' )
+                << std::right << "| " << Bins[ i ] << '\n';
+    }
+
+    auto SaveBaseline( std::string Path ) { BaselineSavePath = std::move( Path ); }
+
+    auto CompareBaseline( std::string Path, double Threshold = 0.05 )
+    {
+        BaselineComparePath = std::move( Path );
+        RegressionThreshold = Threshold;
+    }
+
+    // reports, saves and compares once, the result is meant to be returned from main,
+    // non-zero when the baseline cannot be read or a benchmark regressed against it
+    auto Finish()
+    {
+        if( std::exchange( Finished, true ) || empty() ) return ExitStatus;
+        for( auto&& [ Reporter, Path ] : Reporters )
+        {
+            if( Path.empty() )
+            {
+                Reporter( *this, std::cout );
+                continue;
+            }
+            auto File = std::ofstream{ Path };
+            if( File )
+                Reporter( *this, File );
+            else
+                std::cerr << "Cannot write report to " << Path << '\n';
+        }
+
+        if( ! BaselineComparePath.empty() )
+        {
+            if( const auto Baselines = BenchmarkBaseline::Load( BaselineComparePath ) )
+            {
+                if( BenchmarkBaseline::Compare( *this, *Baselines, RegressionThreshold, std::cout ) )
+                    ExitStatus = EXIT_FAILURE;
+            }
+            else
+            {
+                std::cerr << "Cannot read baseline from " << BaselineComparePath << '\n';
+                ExitStatus = EXIT_FAILURE;
+            }
+        }
+
+        if( ! BaselineSavePath.empty() && ! BenchmarkBaseline::Save( *this, BaselineSavePath ) )
+            std::cerr << "Cannot write baseline to " << BaselineSavePath << '\n';
+        return ExitStatus;
+    }
+
+    // a failed gate still fails the process when main did not return Finish()
+    ~BenchmarkAnalyzer()
+    {
+        if( Finish() == EXIT_SUCCESS ) return;
+        std::cout.flush();
+        std::_Exit( ExitStatus );
+    }
+};
+
+void ReportConsole( const BenchmarkAnalyzer& Results, std::ostream& Out )
+{
+    const auto DigitWidth = 18;
+    const auto TitleWidth =
+    std::max( std::max_element( Results.begin(), Results.end() )->Title.length(), std::size_t{ 24 } );
+    const auto& Baseline       = Results[ Results.BaselinePos ];
+    const auto BaselineMoments = Baseline.ObservationMoments();
+    const auto RelativeTitle   = Results.RelativeUnit == BenchmarkUnit::Bytes ? "Relative(B/s)"
+                               : Results.RelativeUnit == BenchmarkUnit::Items ? "Relative(it/s)"
+                                                                              : "Relative";
+
+    auto cout_row = [ &Out, TW = std::setw( TitleWidth ), DW = std::setw( DigitWidth ),  //
+                      CW = std::setw( 12 ) ](                                            //
+                    std::string_view Title,                                              //
+                    const auto Latency,                                                  //
+                    const auto Interval,                                                 //
+                    const auto Throughput,                                               //
+                    const auto Relative,                                                 //
+                    std::string_view Significant,                                        //
+                    const char fill = ' ' )                                              //
+    {
+        Out << std::setfill( fill ) << std::left << std::fixed  //
+            << TW << Title << std::right                        //
+            << DW << std::setprecision( 2 ) << Latency          //
+            << CW << std::setprecision( 2 ) << Interval         //
+            << DW << std::setprecision( 0 ) << Throughput       //
+            << DW << std::setprecision( 2 ) << Relative         //
+            << CW << Significant                                //
+            << std::setfill( ' ' ) << '\n';
+    };
+
+    auto cout_line = [ &Out, cout_row ] {
+        cout_row( "", "", "", "", "", "", '_' );
+        Out << '\n';
+    };
+
+    const auto Host = BenchmarkHost::Collect();
+    Out << "\n Host     : " << Host.Name << ", " << Host.Cores << " cores, " << Host.Cpu
+        << "\n Kernel   : " << Host.Kernel
+        << "\n Compiler : " << Host.Compiler << ", " << Host.Flags
+        << "\n Scaling  : governor " << Host.Governor << ", turbo " << Host.Turbo << ", SMT "
+        << Host.Smt << "\n";
+    Out << "\n    ______________________"
+           "\n   /                     /"
+           "\n  /  Benchmark Summary  /      TSC "
+        << std::fixed << std::setprecision( 3 ) << TscTimer::Frequency() / 1e9 << " GHz\n";
+    /**/ cout_row( " /_____________________/", "Latency(ns)", "+/-95%CI", "Throughput(op/s)",
+                   RelativeTitle, "Significant" );
+    cout_line();
+    for( auto&& Result : Results )
+    {
+        const auto Observed = Result.Observed() && Baseline.Observed();
+        const auto Significant =
+        &Result == &Baseline ? "baseline"
+        : ! Observed         ? "n/a"
+        : BenchmarkStatistics::DifferSignificantly( Result.ObservationMoments(), BaselineMoments )
+        ? "yes"
+        : "no";
+        auto cout_result = [ & ]( const auto Interval ) {
+            cout_row( Result.Title,                               //
+                      Result.Latency(),                           //
+                      Interval,                                   //
+                      Result.Throughput(),                        //
+                      Results.Relative( Result ),                 //
+                      Significant );
+        };
+        if( Result.Observed() )
+            cout_result( Result.ConfidenceInterval() );
+        else
+            cout_result( "n/a" );
+    }
+    cout_line();
+
+    auto cout_columns = [ &Out, TitleWidth ]( int ColumnWidth ) {
+        return [ &Out, TW = std::setw( TitleWidth ), SW = std::setw( ColumnWidth ) ](  //
+               std::string_view Title,                                                //
+               const auto&... Columns )                                               //
+        {
+            Out << std::left << TW << Title << std::right << std::setprecision( 2 );
+            ( ( Out << SW << Columns ), ... );
+            Out << '\n';
+        };
+    };
+    auto cout_stats = cout_columns( 12 );
+    auto cout_wide  = cout_columns( 16 );  // rates, and latencies which reach seconds past saturation
+
+    Out << " Latency Distribution (ns, per batch)\n";
+    cout_wide( "", "Min", "Median", "P90", "P99", "P99.9", "Max", "StdDev", "MAD" );
+    for( auto&& Result : Results )
+    {
+        if( Result.Samples.empty() && ! Result.Histogram ) continue;  // nothing kept per batch
+        const auto Stats = Result.Statistics();
+        cout_wide( Result.Title, Stats.Min, Stats.Median, Stats.P90, Stats.P99, Stats.P999,
+                    Stats.Max, Stats.StdDev, Stats.MAD );
+    }
+
+    auto Processed = []( auto&& Result ) {
+        return Result.BytesProcessed > 0 || Result.ItemsProcessed > 0;
+    };
+    if( std::any_of( Results.begin(), Results.end(), Processed ) )
+    {
+        Out << "\n Processed (per iteration, and per second)\n";
+        cout_stats( "", "Bytes", "GB/s", "Items", "MItems/s", "ns/Item" );
+        for( auto&& Result : Results )
+            if( Processed( Result ) )
+                cout_stats( Result.Title, Result.BytesPerIteration(),
+                            Result.Rate( BenchmarkUnit::Bytes ) / 1e9, Result.ItemsPerIteration(),
+                            Result.Rate( BenchmarkUnit::Items ) / 1e6, Result.ItemLatency() );
+    }
+
+    if( Results.ShowCounters )
+    {
+        if( std::none_of( Results.begin(), Results.end(),  //
+                          []( auto&& Result ) { return Result.CounterMask; } ) )
+            Out << "\n Hardware Counters unavailable ( perf_event_open not permitted )\n";
+        else
+        {
+            Out << "\n Hardware Counters (per iteration, loop included)\n";
+            Out << std::left << std::setw( TitleWidth ) << "" << std::right;
+            for( auto Name : BenchmarkCounters::Names ) Out << std::setw( 12 ) << Name;
+            Out << std::setw( 12 ) << "IPC" << '\n';
+            for( auto&& Result : Results )
+            {
+                const auto Iteration = std::max( Result.MeasuredIteration, std::size_t{ 1 } );
+                const auto Counted = [ & ]( std::size_t i ) { return Result.CounterMask >> i & 1; };
+                auto cout_counter = [ & ]( bool Valid, double Value ) {
+                    if( Valid )
+                        Out << std::setw( 12 ) << std::setprecision( 2 ) << Value;
+                    else
+                        Out << std::setw( 12 ) << "n/a";
+                };
+                Out << std::left << std::setw( TitleWidth ) << Result.Title << std::right;
+                for( auto i = std::size_t{ 0 }; i < BenchmarkCounters::Count; ++i )
+                    cout_counter( Counted( i ), Result.Counters[ i ] / Iteration );
+                cout_counter( Counted( 0 ) && Counted( 1 ) && Result.Counters[ 1 ] > 0,
+                              Result.Counters[ 0 ] / Result.Counters[ 1 ] );
+                Out << '\n';
+            }
+        }
+    }
+
+    // counts are small fractions per iteration, hence the general format
+    if( Results.ShowResources )
+    {
+        Out << "\n Resource Usage (per iteration)\n";
+        Out << std::left << std::setw( TitleWidth ) << "" << std::right;
+        for( auto Name : BenchmarkResourceUsage::Names ) Out << std::setw( 13 ) << Name;
+        Out << '\n' << std::defaultfloat;
+        for( auto&& Result : Results )
+        {
+            const auto Iteration = std::max( Result.MeasuredIteration, std::size_t{ 1 } );
+            Out << std::left << std::setw( TitleWidth ) << Result.Title << std::right;
+            for( auto Value : Result.Resources.Values )
+                Out << std::setw( 13 ) << std::setprecision( 4 ) << Value / Iteration;
+            Out << '\n';
+        }
+        Out << std::fixed;
+    }
+
+    // one dimensional sweeps with enough points to tell the models apart
+    auto Families = std::vector<std::string>{};
+    for( auto&& Result : Results )
+        if( Result.Args.size() == 1 &&
+            std::find( Families.begin(), Families.end(), Result.Family ) == Families.end() &&
+            std::count_if( Results.begin(), Results.end(), [ & ]( auto&& Other ) {
+                return Other.Family == Result.Family && Other.Args.size() == 1;
+            } ) >= 3 )
+            Families.push_back( Result.Family );
+
+    if( ! Families.empty() )
+    {
+        Out << "\n Complexity (ns)\n";
+        cout_stats( "", "Best Fit", "Coefficient", "RMS(%)" );
+        for( auto&& Family : Families )
+        {
+            auto Points = std::vector<std::pair<double, double>>{};
+            for( auto&& Result : Results )
+                if( Result.Family == Family && Result.Args.size() == 1 )
+                    Points.emplace_back( Result.Args.front(), Result.Latency() );
+            const auto Fit = BenchmarkComplexity::Fit( Points );
+            cout_stats( " " + Family, Fit.Name, Fit.Coefficient, Fit.RMS * 100 );
+        }
+    }
+
+    if constexpr( BenchmarkAllocations::Enabled )
+    {
+        Out << "\n Allocations (per iteration, peak above the start of measurement)\n";
+        cout_stats( "", "Count", "Bytes", "Peak(bytes)" );
+        for( auto&& Result : Results )
+            cout_stats( Result.Title, Result.Allocations(), Result.AllocatedBytes(),
+                        Result.PeakBytes );
+    }
+
+    if( std::any_of( Results.begin(), Results.end(),  //
+                     []( auto&& Result ) { return Result.Threads > 0; } ) )
+    {
+        Out << "\n Thread Scaling\n";
+        cout_wide( "", "Threads", "Total(op/s)", "Thread(ns)", "Efficiency" );
+        for( auto&& Result : Results )
+        {
+            if( Result.Threads == 0 ) continue;
+            const auto Single = std::find_if( Results.begin(), Results.end(), [ & ]( auto&& Other ) {
+                return Other.Family == Result.Family && Other.Threads == 1;
+            } );
+            const auto Efficiency = Single == Results.end() ? 0.0
+                                                    : Result.Throughput() /
+                                                      ( Result.Threads * Single->Throughput() );
+            cout_wide( Result.Title, Result.Threads, Result.Throughput(), Result.Latency(),
+                       Efficiency );
+        }
+    }
+
+    auto Cold = []( auto&& Result ) { return Result.Cache == BenchmarkCacheMode::Cold; };
+    if( std::any_of( Results.begin(), Results.end(), Cold ) )
+    {
+        Out << "\n Cache Modes (ns)\n";
+        cout_stats( "", "Warm", "Cold", "Cold/Warm" );
+        for( auto&& Result : Results )
+        {
+            if( ! Cold( Result ) ) continue;
+            const auto Title = Result.Title.substr( 0, Result.Title.size() - 5 );
+            const auto Warm  = std::find_if( Results.begin(), Results.end(), [ & ]( auto&& Other ) {
+                return Other.Title == Title;
+            } );
+            if( Warm == Results.end() )
+                cout_stats( Title, "n/a", Result.Latency(), "n/a" );
+            else
+                cout_stats( Title, Warm->Latency(), Result.Latency(),
+                            Result.Latency() / Warm->Latency() );
+        }
+    }
+
+    if( std::any_of( Results.begin(), Results.end(),  //
+                     []( auto&& Result ) { return Result.InFlight > 0; } ) )
+    {
+        Out << "\n Async Completions (ns)\n";
+        cout_stats( "", "InFlight", "Ops/s", "Mean", "P50", "P99" );
+        for( auto&& Result : Results )
+        {
+            if( Result.InFlight == 0 ) continue;
+            const auto Stats = Result.CompletionStatistics();
+            cout_stats( Result.Title, Result.InFlight, Result.Throughput(), Stats.Mean, Stats.Median,
+                        Stats.P99 );
+        }
+    }
+
+    if( std::any_of( Results.begin(), Results.end(),  //
+                     []( auto&& Result ) { return Result.OfferedRate > 0; } ) )
+    {
+        Out << "\n Open Loop (ns from the intended start)\n";
+        cout_wide( "", "Offered/s", "Achieved/s", "P50", "P99", "P99.9", "Max" );
+        for( auto&& Result : Results )
+        {
+            if( Result.OfferedRate == 0 ) continue;
+            const auto Stats = Result.Statistics();
+            cout_wide( Result.Title, Result.OfferedRate, Result.Throughput(), Stats.Median,
+                        Stats.P99, Stats.P999, Stats.Max );
+        }
+
+        // the harness keeps up below saturation, past it the achieved rate levels off
+        // short of the offered one
+        auto Behind = []( auto&& Result ) {
+            return Result.Throughput() < 0.95 * Result.OfferedRate;
+        };
+        auto Families = std::vector<std::string>{};
+        for( auto&& Result : Results )
+            if( Result.OfferedRate > 0 &&
+                std::find( Families.begin(), Families.end(), Result.Family ) == Families.end() )
+                Families.push_back( Result.Family );
+        for( auto&& Family : Families )
+        {
+            auto Saturation = 0.0;
+            auto Saturated  = false;
+            for( auto&& Result : Results )
+                if( Result.Family == Family && Result.OfferedRate > 0 )
+                {
+                    Saturation = std::max( Saturation, Result.Throughput() );
+                    Saturated  = Saturated || Behind( Result );
+                }
+            if( Saturated )
+                Out << ' ' << Family << " saturates at " << std::setprecision( 0 ) << Saturation
+                    << " op/s\n";
+            else
+                Out << ' ' << Family << " keeps up with every offered load\n";
+        }
+    }
+
+    auto Repeated = []( auto&& Result ) { return Result.Repetitions.size() > 1; };
+    if( std::any_of( Results.begin(), Results.end(), Repeated ) )
+    {
+        Out << "\n Repetitions (ns)\n";
+        cout_stats( "", "Count", "Rejected", "Fastest", "Slowest" );
+        for( auto&& Result : Results )
+        {
+            auto Latencies = std::vector<double>{};
+            for( auto&& Repetition : Result.Repetitions )
+                Latencies.push_back( Repetition.Latency() );
+            const auto [ Fastest, Slowest ] =
+            std::minmax_element( Latencies.begin(), Latencies.end() );
+            cout_stats( Result.Title, Result.Repetitions.size(), Result.RejectedRepetitions(),
+                        Latencies.empty() ? 0.0 : *Fastest, Latencies.empty() ? 0.0 : *Slowest );
+        }
+    }
+
+    for( auto&& Section : Results.ConsoleSections ) Section( Results, Out );
+
+    if( Results.ShowHistogram )
+        for( auto&& Result : Results )
+            if( ! Result.Samples.empty() || Result.Histogram )
+                BenchmarkAnalyzer::PrintHistogram( Result, Out );
+}
+// every field the harness measures, times in nanoseconds unless named cycles
+void ReportJson( const BenchmarkAnalyzer& Results, std::ostream& Out )
+{
+    auto Quote = []( std::string_view Text ) {
+        auto Quoted = std::string{ "\"" };
+        for( auto Char : Text )
+            if( Char == '"' || Char == '\\' )
+                Quoted += { '\\', Char };
+            else if( static_cast<unsigned char>( Char ) < 0x20 )
+            {
+                char Escaped[ 8 ];
+                std::snprintf( Escaped, sizeof( Escaped ), "\\u%04x", Char );
+                Quoted += Escaped;
+            }
+            else
+                Quoted += Char;
+        return Quoted + '"';
+    };
+    auto Number = []( double Value ) {
+        if( ! std::isfinite( Value ) ) return std::string{ "null" };
+        auto Text = std::ostringstream{};
+        Text << std::setprecision( 10 ) << Value;
+        return Text.str();
+    };
+
+    const auto Host               = BenchmarkHost::Collect();
+    const auto& Environment       = BenchmarkEnvironment::Current();
+    const auto& Baseline          = Results[ Results.BaselinePos ];
+    constexpr const char* Units[] = { "iterations", "bytes", "items" };
+
+    Out << "{\n  \"host\": {"
+        << "\n    \"name\": " << Quote( Host.Name ) << ","
+        << "\n    \"cpu\": " << Quote( Host.Cpu ) << ","
+        << "\n    \"cores\": " << Host.Cores << ","
+        << "\n    \"tsc_hz\": " << Number( Host.TscFrequency ) << ","
+        << "\n    \"compiler\": " << Quote( Host.Compiler ) << ","
+        << "\n    \"flags\": " << Quote( Host.Flags ) << ","
+        << "\n    \"kernel\": " << Quote( Host.Kernel ) << ","
+        << "\n    \"governor\": " << Quote( Host.Governor ) << ","
+        << "\n    \"turbo\": " << Quote( Host.Turbo ) << ","
+        << "\n    \"smt\": " << Quote( Host.Smt ) << ","
+        << "\n    \"core\": " << Environment.Core << ","
+        << "\n    \"realtime\": " << ( Environment.Realtime ? "true" : "false" ) << ","
+        << "\n    \"date\": " << Quote( Host.Date ) << "\n  },"
+        << "\n  \"baseline\": " << Quote( Baseline.Title.substr( 1 ) ) << ","
+        << "\n  \"relative_unit\": " << Quote( Units[ static_cast<int>( Results.RelativeUnit ) ] )
+        << ","
+        << "\n  \"benchmarks\": [";
+
+    for( auto&& Result : Results )
+    {
+        const auto Stats = Result.Statistics();
+        const auto Cache = Result.Cache == BenchmarkCacheMode::Cold ? "cold" : "warm";
+        const auto Samples = Result.Histogram ? Result.Histogram->Total : Result.Samples.size();
+        Out << ( &Result == &Results.front() ? "" : "," ) << "\n    {"
+            << "\n      \"title\": " << Quote( Result.Title.substr( 1 ) ) << ","
+            << "\n      \"family\": " << Quote( Result.Family ) << ","
+            << "\n      \"args\": [";
+        for( auto&& Arg : Result.Args ) Out << ( &Arg == &Result.Args.front() ? "" : ", " ) << Arg;
+        Out << "],"
+            << "\n      \"threads\": " << Result.Threads << ","
+            << "\n      \"cache\": " << Quote( Cache ) << ","
+            << "\n      \"iterations\": " << Result.TotalIteration << ","
+            << "\n      \"warmup_iterations\": " << Result.WarmupIteration << ","
+            << "\n      \"cycles\": " << Result.TotalCycle << ","
+            << "\n      \"cycles_per_iteration\": " << Number( Result.Cycle() ) << ","
+            << "\n      \"ns\": " << Number( Result.Latency() ) << ","
+            << "\n      \"ci95_ns\": " << Number( Result.ConfidenceInterval() ) << ","
+            << "\n      \"throughput\": " << Number( Result.Throughput() ) << ","
+            << "\n      \"relative\": " << Number( Results.Relative( Result ) ) << ","
+            << "\n      \"processed\": {"
+            << " \"bytes_per_iteration\": " << Number( Result.BytesPerIteration() ) << ","
+            << " \"items_per_iteration\": " << Number( Result.ItemsPerIteration() ) << ","
+            << " \"bytes_per_second\": " << Number( Result.Rate( BenchmarkUnit::Bytes ) ) << ","
+            << " \"items_per_second\": " << Number( Result.Rate( BenchmarkUnit::Items ) ) << ","
+            << " \"ns_per_item\": " << Number( Result.ItemLatency() ) << " },"
+            << "\n      \"samples\": " << Samples << ","
+            << "\n      \"allocations\": {"
+            << " \"count\": " << Number( Result.Allocations() ) << ","
+            << " \"bytes\": " << Number( Result.AllocatedBytes() ) << ","
+            << " \"peak_bytes\": " << Result.PeakBytes << ","
+            << " \"tracked\": " << ( BenchmarkAllocations::Enabled ? "true" : "false" ) << " },"
+            << "\n      \"statistics\": {"
+            << " \"min\": " << Number( Stats.Min ) << ","
+            << " \"median\": " << Number( Stats.Median ) << ","
+            << " \"p90\": " << Number( Stats.P90 ) << ","
+            << " \"p99\": " << Number( Stats.P99 ) << ","
+            << " \"p999\": " << Number( Stats.P999 ) << ","
+            << " \"max\": " << Number( Stats.Max ) << ","
+            << " \"mean\": " << Number( Stats.Mean ) << ","
+            << " \"stddev\": " << Number( Stats.StdDev ) << ","
+            << " \"mad\": " << Number( Stats.MAD ) << " },";
+        if( Result.OfferedRate > 0 )
+            Out << "\n      \"offered_rate\": " << Number( Result.OfferedRate ) << ",";
+        if( Result.Histogram )
+        {
+            auto Histogram = std::ostringstream{};  // in cycles, for BenchmarkHistogram::Load
+            Result.Histogram->Save( Histogram );
+            Out << "\n      \"histogram\": " << Quote( Histogram.str() ) << ",";
+        }
+        if( Result.InFlight > 0 )
+        {
+            const auto Completion = Result.CompletionStatistics();
+            Out << "\n      \"async\": {"
+                << " \"in_flight\": " << Result.InFlight << ","
+                << " \"completions\": " << Result.Completions.size() << ","
+                << " \"mean_ns\": " << Number( Completion.Mean ) << ","
+                << " \"p50_ns\": " << Number( Completion.Median ) << ","
+                << " \"p99_ns\": " << Number( Completion.P99 ) << ","
+                << " \"max_ns\": " << Number( Completion.Max ) << " },";
+        }
+        if( Results.ShowResources )
+        {
+            const auto Iteration = std::max( Result.MeasuredIteration, std::size_t{ 1 } );
+            Out << "\n      \"resources\": {";
+            for( auto i = std::size_t{ 0 }; i < BenchmarkResourceUsage::Count; ++i )
+                Out << ( i ? ", " : " " ) << Quote( BenchmarkResourceUsage::Keys[ i ] ) << ": "
+                    << Number( Result.Resources.Values[ i ] / Iteration );
+            Out << " },";
+        }
+        Out << "\n      \"repetitions\": [";
+        for( auto&& Repetition : Result.Repetitions )
+            Out << ( &Repetition == &Result.Repetitions.front() ? "" : "," )
+                << "\n        { \"cycles\": " << Repetition.TotalCycle
+                << ", \"iterations\": " << Repetition.TotalIteration
+                << ", \"ns\": " << Number( Repetition.Latency() )
+                << ", \"outlier\": " << ( Repetition.Outlier ? "true" : "false" ) << " }";
+        Out << ( Result.Repetitions.empty() ? "" : "\n      " ) << "],"
+            << "\n      \"counters\": {";
+        const auto Iteration = std::max( Result.MeasuredIteration, std::size_t{ 1 } );
+        for( auto i = std::size_t{ 0 }; i < BenchmarkCounters::Count; ++i )
+        {
+            const auto Counted = Result.CounterMask >> i & 1;
+            Out << ( i ? ", " : " " ) << Quote( BenchmarkCounters::Names[ i ] ) << ": "
+                << ( Counted ? Number( Result.Counters[ i ] / Iteration ) : "null" );
+        }
+        Out << " }\n    }";
+    }
+    Out << "\n  ]\n}\n";
+}
+
+// one row per benchmark, empty cells for counters that were not counted
+void ReportCsv( const BenchmarkAnalyzer& Results, std::ostream& Out )
+{
+    auto Quote = []( std::string_view Text ) {
+        auto Quoted = std::string{ "\"" };
+        for( auto Char : Text ) Quoted += Char == '"' ? std::string{ "\"\"" } : std::string{ Char };
+        return Quoted + '"';
+    };
+    // missing values are left empty, as ReportJson writes them null
+    auto Number = []( double Value ) {
+        if( ! std::isfinite( Value ) ) return std::string{};
+        auto Text = std::ostringstream{};
+        Text << std::setprecision( 10 ) << Value;
+        return Text.str();
+    };
+
+    Out << "title,family,args,threads,cache,iterations,cycles,ns,ci95_ns,throughput,relative,"
+           "min,median,p90,p99,p999,max,mean,stddev,mad,allocations,allocated_bytes,peak_bytes,"
+           "in_flight,completion_p50,completion_p99,offered_rate,bytes_per_iteration,"
+           "items_per_iteration,bytes_per_second,items_per_second,ns_per_item";
+    for( auto Name : BenchmarkCounters::Names ) Out << ',' << Name;
+    if( Results.ShowResources )
+        for( auto Key : BenchmarkResourceUsage::Keys ) Out << ',' << Key;
+    Out << '\n';
+
+    for( auto&& Result : Results )
+    {
+        auto Args = std::string{};
+        for( auto&& Arg : Result.Args ) Args += ( Args.empty() ? "" : "/" ) + std::to_string( Arg );
+
+        const auto Stats = Result.Statistics();
+        Out << Quote( Result.Title.substr( 1 ) ) << ',' << Quote( Result.Family ) << ',' << Args
+            << ',' << Result.Threads << ','
+            << ( Result.Cache == BenchmarkCacheMode::Cold ? "cold" : "warm" ) << ','
+            << Result.TotalIteration << ',' << Result.TotalCycle << ','
+            << Number( Result.Latency() ) << ',' << Number( Result.ConfidenceInterval() ) << ','
+            << Number( Result.Throughput() ) << ',' << Number( Results.Relative( Result ) ) << ','
+            << Number( Stats.Min ) << ',' << Number( Stats.Median ) << ',' << Number( Stats.P90 )
+            << ',' << Number( Stats.P99 ) << ',' << Number( Stats.P999 ) << ','
+            << Number( Stats.Max ) << ',' << Number( Stats.Mean ) << ',' << Number( Stats.StdDev )
+            << ',' << Number( Stats.MAD ) << ',' << Number( Result.Allocations() ) << ','
+            << Number( Result.AllocatedBytes() ) << ',' << Result.PeakBytes << ',';
+        if( Result.InFlight > 0 )
+        {
+            const auto Completion = Result.CompletionStatistics();
+            Out << Result.InFlight << ',' << Number( Completion.Median ) << ','
+                << Number( Completion.P99 );
+        }
+        else
+            Out << ",,";
+        Out << ',';
+        if( Result.OfferedRate > 0 ) Out << Number( Result.OfferedRate );
+        Out << ',' << Number( Result.BytesPerIteration() ) << ','
+            << Number( Result.ItemsPerIteration() ) << ','
+            << Number( Result.Rate( BenchmarkUnit::Bytes ) ) << ','
+            << Number( Result.Rate( BenchmarkUnit::Items ) ) << ','
+            << Number( Result.ItemLatency() );
+        const auto Iteration = std::max( Result.MeasuredIteration, std::size_t{ 1 } );
+        for( auto i = std::size_t{ 0 }; i < BenchmarkCounters::Count; ++i )
+        {
+            Out << ',';
+            if( Result.CounterMask >> i & 1 ) Out << Number( Result.Counters[ i ] / Iteration );
+        }
+        if( Results.ShowResources )
+            for( auto Value : Result.Resources.Values ) Out << ',' << Number( Value / Iteration );
+        Out << '\n';
+    }
+}
+static auto BenchmarkResults = BenchmarkAnalyzer{};
+
+struct BenchmarkConfig
+{
+    std::chrono::nanoseconds MinTime{};        // measure at least this long ...
+    std::chrono::nanoseconds MaxTime{};        // ... and at most this long
+    std::chrono::nanoseconds MaxWarmupTime{};  // give up waiting for a steady state after this long
+    double RelativeError{};                    // stop once the 95% CI of the mean is this tight
+    std::size_t MaxIteration{};
+    std::size_t Repetitions{};                 // independent runs, each with its own warmup
+    std::size_t Threads{};                     // most threads for BenchmarkThreaded
+    BenchmarkCacheMode Cache{};
+    double BytesPerIteration{};  // what the body processes, never taken from Defaults
+    double ItemsPerIteration{};
+
+    // zero fields are taken from Defaults
+    auto Resolve( const BenchmarkConfig& Defaults ) const
+    {
+        auto Resolved = *this;
+        if( Resolved.MinTime == Resolved.MinTime.zero() ) Resolved.MinTime = Defaults.MinTime;
+        if( Resolved.MaxTime == Resolved.MaxTime.zero() ) Resolved.MaxTime = Defaults.MaxTime;
+        if( Resolved.MaxWarmupTime == Resolved.MaxWarmupTime.zero() )
+            Resolved.MaxWarmupTime = Defaults.MaxWarmupTime;
+        if( Resolved.RelativeError == 0 ) Resolved.RelativeError = Defaults.RelativeError;
+        if( Resolved.MaxIteration == 0 ) Resolved.MaxIteration = Defaults.MaxIteration;
+        if( Resolved.Repetitions == 0 ) Resolved.Repetitions = Defaults.Repetitions;
+        if( Resolved.Threads == 0 ) Resolved.Threads = Defaults.Threads;
+        if( Resolved.Cache == BenchmarkCacheMode::Default ) Resolved.Cache = Defaults.Cache;
+        Resolved.MaxTime = std::max( Resolved.MaxTime, Resolved.MinTime );
+        return Resolved;
+    }
+};
+
+static auto BenchmarkDefaults = BenchmarkConfig{ .MinTime       = std::chrono::milliseconds{ 50 },
+                                                 .MaxTime       = std::chrono::milliseconds{ 2000 },
+                                                 .MaxWarmupTime = std::chrono::milliseconds{ 500 },
+                                                 .RelativeError = 0.01,
+                                                 .MaxIteration  = std::size_t{ 1 } << 30,
+                                                 .Repetitions   = 1,
+                                                 .Threads       = std::thread::hardware_concurrency(),
+                                                 .Cache         = BenchmarkCacheMode::Warm };
+
+// stops a measured repetition once the 95% CI of the mean is within RelativeError,
+// no sooner than MinTime
+struct BenchmarkStopConverged
+{
+    constexpr static auto Moments = true;  // needs the running mean / variance of the batches
+
+    static auto Done( const auto& Iterator, std::uint64_t Now )
+    {
+        return Now >= Iterator.MinCycle && Iterator.Converged();
+    }
+};
+
+// stops a measured repetition at MinTime, whatever the spread
+struct BenchmarkStopAtMinTime
+{
+    constexpr static auto Moments = false;
+
+    static auto Done( const auto& Iterator, std::uint64_t Now ) { return Now >= Iterator.MinCycle; }
+};
+
+// every measured batch, or a histogram of them once BenchmarkResults.HistogramDigits is set
+struct BenchmarkStoreSamples
+{
+    static auto Prepare( BenchmarkResult& Result, std::size_t Capacity )
+    {
+        if( BenchmarkResults.HistogramDigits > 0 )
+            Result.Histogram.emplace( BenchmarkResults.HistogramDigits );
+        else
+        {
+            // faulted in now, Record runs after the clock is read and its first touch of a page
+            // would be charged to the next batch
+            Result.Samples.resize( Capacity );
+            Result.Samples.clear();
+        }
+    }
+
+    static auto Record( BenchmarkResult& Result, double Sample )
+    {
+        if( ! Result.Histogram ) return Result.Samples.push_back( Sample );
+        if( ! Result.Histogram->Allocates( Sample ) ) return Result.Histogram->Record( Sample );
 
-        std::cout << "\n    ______________________"
-                     "\n   /                     /"
-                     "\n  /  Benchmark Summary  /\n";
-        /**/ cout_row( " /_____________________/", "Latency", "Throughput", "Relative" );
-        cout_line();
-        for( auto&& Result : *this )
-            cout_row( Result.Title,         //
-                      Result.Latency(),     //
-                      Result.Throughput(),  //
-                      Result.Throughput() / ThroughputBaseline );
-        cout_line();
+        // a new row of buckets is set aside like a pause, neither timed nor counted
+        auto& Allocations   = BenchmarkAllocations::Current();
+        const auto Tracking = std::exchange( Allocations.Tracking, false );
+        BenchmarkPause::Pause();
+        Result.Histogram->Record( Sample );
+        BenchmarkPause::Resume();
+        Allocations.Tracking = Tracking;
     }
 };
 
-static auto BenchmarkResults = BenchmarkAnalyzer{};
+// keeps only the totals, the distribution and confidence interval are left empty
+struct BenchmarkStoreNothing
+{
+    static auto Prepare( BenchmarkResult&, std::size_t ) {}
+    static auto Record( BenchmarkResult&, double ) {}
+};
+
+// compile time configuration of BenchmarkContainer, derive from it to replace a part.
+// What a policy leaves out costs nothing in the loop, it is not compiled in
+struct BenchmarkPolicy
+{
+    using Timer    = TscTimer;                // Start, Stop, Frequency and ToTicks
+    using Stopping = BenchmarkStopConverged;  // when a measured repetition is over
+    using Storage  = BenchmarkStoreSamples;   // where every measured batch goes
+    constexpr static auto Counting  = true;  // hardware counters, resources and allocations
+    constexpr static auto ColdCache = true;  // BenchmarkCacheMode::Cold, a branch per batch
+};
+
+// for nanosecond scale bodies : the loop is a decrement and a branch, and between batches
+// only the clock is read
+struct BenchmarkLeanPolicy : BenchmarkPolicy
+{
+    using Stopping = BenchmarkStopAtMinTime;
+    using Storage  = BenchmarkStoreNothing;
+    constexpr static auto Counting  = false;
+    constexpr static auto ColdCache = false;
+};
 
-struct BenchmarkContainer
+template <typename Policy>
+struct BasicBenchmarkContainer
 {
-    using clock      = std::chrono::steady_clock;
-    using time_point = std::chrono::time_point<clock>;
+    using Timer = typename Policy::Timer;
+
+    // batches stop growing once they span this long, keeping samples fine-grained
+    constexpr static auto SampleDuration = std::chrono::microseconds{ 1 };
 
-    constexpr static auto MaxDuration  = std::chrono::milliseconds{ 2000 };
-    constexpr static auto MaxIteration = std::size_t{ 12345 };
+    // warmup ends when the mean of the last WarmupWindow batches is within
+    // WarmupTolerance of the WarmupWindow batches before them
+    constexpr static auto WarmupWindow    = std::size_t{ 8 };
+    constexpr static auto WarmupTolerance = 0.05;
 
     BenchmarkResult& Result;
+    double LoopOverhead;  // cycles per iteration charged to the loop itself
+    BenchmarkConfig Config;
+    bool Counting;    // hardware counters around the measured region
+    bool Accounting;  // resource usage snapshots around it
+    std::barrier<>* Rendezvous = nullptr;  // shared by threads that must measure together
 
     struct Sentinel
     {};
 
+    // results are kept in TSC cycles whatever the Timer counts in
+    static auto ToCycles( auto Ticks )
+    {
+        if constexpr( std::is_same_v<Timer, TscTimer> )
+            return Ticks;
+        else
+            return static_cast<decltype( Ticks )>( Ticks * TscTimer::Frequency() /
+                                                   Timer::Frequency() );
+    }
+
+    static auto FromCycles( auto Cycles )
+    {
+        if constexpr( std::is_same_v<Timer, TscTimer> )
+            return Cycles;
+        else
+            return static_cast<decltype( Cycles )>( Cycles * Timer::Frequency() /
+                                                    TscTimer::Frequency() );
+    }
+
+    // the clock is only consulted between batches, and batches grow geometrically,
+    // so the per-iteration cost of the loop is a decrement and a branch.
+    // Result.Samples is expected to have room for every batch already
+    // so that recording a batch never allocates
     template <typename BaseRange>
     struct Iterator
     {
         BaseRange& Base;
-        time_point EndTime;
-        std::size_t RemainIteration;
-        std::size_t StartCycle;
+        std::size_t BatchRemain;
+        std::size_t BatchSize;
+        std::size_t TotalIteration;
+        std::uint64_t StartCycle;  // in Timer ticks, like every other cycle of the iterator
+        std::uint64_t BatchCycle;
+        std::uint64_t MinCycle;  // measurement may stop from here on
+        std::uint64_t EndCycle;  // current phase must stop here
+        std::uint64_t SampleCycle;
+        std::uint64_t PausedCycle;  // since StartCycle
+
+        bool Warming;
+        std::size_t WarmupCount;
+        double WarmupHistory[ 2 * BaseRange::WarmupWindow ];
+
+        std::size_t SampleCount;  // running mean / variance of the measured samples
+        double SampleMean;
+        double SampleM2;
+
+        BenchmarkCounters Counters;
+        BenchmarkResourceUsage Resources;  // at the start of the measurement
 
         auto operator*() { return 0; }
-        auto operator++() { --RemainIteration; }
-        auto operator!=( Sentinel ) { return RemainIteration > 0 && clock::now() < EndTime; }
+        auto operator++()
+        {
+            --BatchRemain;
+        }
+        auto operator!=( Sentinel ) { return BatchRemain > 0 || NextBatch(); }
+
+        auto Settled( double Sample )
+        {
+            constexpr auto Window = BaseRange::WarmupWindow;
+            WarmupHistory[ WarmupCount++ % ( 2 * Window ) ] = Sample;
+            if( WarmupCount < 2 * Window ) return false;
+
+            auto Older = 0.0, Newer = 0.0;
+            for( auto i = std::size_t{ 0 }; i < Window; ++i )
+            {
+                Older += WarmupHistory[ ( WarmupCount + i ) % ( 2 * Window ) ];
+                Newer += WarmupHistory[ ( WarmupCount + Window + i ) % ( 2 * Window ) ];
+            }
+            return std::abs( Newer - Older ) <= BaseRange::WarmupTolerance * Older;
+        }
+
+        auto Converged() const
+        {
+            if( SampleCount < 2 * BaseRange::WarmupWindow ) return false;
+            const auto HalfWidth = 1.96 * std::sqrt( SampleM2 / ( SampleCount - 1 ) / SampleCount );
+            return HalfWidth <= Base.Config.RelativeError * SampleMean;
+        }
+
+        // a fresh run, as if from a new container
+        auto StartRepetition( std::uint64_t Now )
+        {
+            BenchmarkProcessed::Current() = {};
+            BatchRemain = BatchSize = 1;
+            TotalIteration          = 0;
+            StartCycle = BatchCycle = MinCycle = Now;
+            EndCycle                           = Now + Timer::ToTicks( Base.Config.MaxWarmupTime );
+            PausedCycle                        = 0;
+            Warming                            = true;
+            WarmupCount = SampleCount = 0;
+            SampleMean = SampleM2 = 0;
+        }
+
+        auto FinishRepetition( std::uint64_t Now, std::size_t Iteration )
+        {
+            if constexpr( Policy::Counting )
+            {
+                Counters.Stop();
+                BenchmarkAllocations::Current().Tracking = false;
+                if( Base.Accounting && ! Warming )
+                    Base.Result.Resources += BenchmarkResourceUsage::Snapshot() - Resources;
+            }
+            auto& Processed = BenchmarkProcessed::Current();
+            Base.Result.BytesProcessed += Base.Config.BytesPerIteration * Iteration + Processed.Bytes;
+            Base.Result.ItemsProcessed += Base.Config.ItemsPerIteration * Iteration + Processed.Items;
+            Processed = {};
+            const auto Elapsed =
+            ToCycles( Now - StartCycle - std::min( PausedCycle, Now - StartCycle ) );
+            const auto Overhead = static_cast<std::uint64_t>( Base.LoopOverhead * Iteration );
+            Base.Result.Repetitions.push_back(
+            { Elapsed > Overhead ? Elapsed - Overhead : 0, Iteration, false } );
+        }
+
+        auto StartMeasurement( std::uint64_t Now )
+        {
+            Base.Result.WarmupIteration = TotalIteration;
+            Warming                     = false;
+            TotalIteration              = 0;
+            StartCycle                  = Now;
+            PausedCycle                 = 0;
+            MinCycle                    = Now + Timer::ToTicks( Base.Config.MinTime );
+            EndCycle                    = Now + Timer::ToTicks( Base.Config.MaxTime );
+            BenchmarkProcessed::Current() = {};  // warmup does not count
+            if constexpr( Policy::Counting )
+            {
+                // left out of the first batch like any other pause : enabling the counters is a
+                // system call, and reading schedstat allocates so it also precedes the tracking
+                if( Base.Accounting || Counters.Leader() >= 0 )
+                {
+                    BenchmarkPause::Pause();
+                    if( Base.Accounting ) Resources = BenchmarkResourceUsage::Snapshot();
+                    Counters.Start();
+                    BenchmarkPause::Resume();
+                }
+                BenchmarkAllocations::Current().Tracking = true;
+            }
+        }
+
+        [[gnu::noinline]] bool NextBatch()
+        {
+            // batches grow and are sized by wall time, samples leave out paused time
+            auto Now              = Timer::Stop();
+            const auto BatchWall  = Now - BatchCycle;
+            const auto Paused     = FromCycles( BenchmarkPause::Take( ToCycles( BatchWall ) ) );
+            const auto BatchTotal = ToCycles( 1.0 * ( BatchWall - Paused ) );
+            const auto BatchCost  = std::max( BatchWall / BatchSize, std::uint64_t{ 1 } );
+            const auto Sample     = std::max( BatchTotal / BatchSize - Base.LoopOverhead, 0.0 );
+            const auto Growing    = BatchWall < SampleCycle;
+            PausedCycle += Paused;
+            TotalIteration += BatchSize;
+
+            if( Warming )
+            {
+                // drift is only meaningful between batches of the same size
+                if( Growing ) WarmupCount = 0;
+                if( ( ! Growing && Settled( Sample ) ) || Now >= EndCycle )
+                {
+                    // whoever settles first waits, untimed, for the others
+                    if( Base.Rendezvous ) Base.Rendezvous->arrive_and_wait(), Now = Timer::Start();
+                    StartMeasurement( Now );
+                }
+            }
+            else
+            {
+                Policy::Storage::Record( Base.Result, Sample );
+                if constexpr( Policy::Stopping::Moments )
+                {
+                    const auto Delta = Sample - SampleMean;
+                    SampleMean += Delta / ++SampleCount;
+                    SampleM2 += Delta * ( Sample - SampleMean );
+                }
+
+                if( TotalIteration >= Base.Config.MaxIteration || Now >= EndCycle ||
+                    Policy::Stopping::Done( *this, Now ) )
+                {
+                    FinishRepetition( Now, TotalIteration );
+                    if( Base.Result.Repetitions.size() >= Base.Config.Repetitions )
+                        return BatchSize = 0, false;
+                    StartRepetition( Timer::Start() );
+                    return true;
+                }
+            }
+
+            // double the batch until it spans a sample, but never past the iteration cap
+            // or what the remaining time affords
+            const auto Grown      = Growing ? BatchSize * 2 : BatchSize;
+            const auto Remain     = EndCycle - std::min( Now, EndCycle );
+            const auto Affordable = std::max( Remain / BatchCost, std::uint64_t{ 1 } );
+            BatchRemain = BatchSize =
+            std::min( { Grown, Base.Config.MaxIteration - TotalIteration, Affordable } );
+            BatchCycle = Now;
+
+            // one iteration per batch, evicted once the bookkeeping above is done, so that only
+            // the way back into the loop runs cold along with the body
+            if constexpr( Policy::ColdCache )
+                if( Base.Config.Cache == BenchmarkCacheMode::Cold )
+                {
+                    BatchRemain = BatchSize = 1;
+                    BenchmarkCache::Evict();
+                    BatchCycle = Timer::Start();
+                    PausedCycle += BatchCycle - Now;
+                }
+            return true;
+        }
 
         Iterator( BaseRange& Base_ )
-            : Base{ Base_ },                                      //
-              EndTime{ clock::now() + BaseRange::MaxDuration },  //
-              RemainIteration{ BaseRange::MaxIteration },        //
-              StartCycle{ __rdtsc() }
-        {}
+            : Base{ Base_ },                                                        //
+              BatchRemain{ 1 },                                                     //
+              BatchSize{ 1 },                                                       //
+              TotalIteration{ 0 },                                                  //
+              StartCycle{ Timer::Start() },                                         //
+              BatchCycle{ StartCycle },                                             //
+              MinCycle{ StartCycle },                                               //
+              EndCycle{ StartCycle + Timer::ToTicks( Base.Config.MaxWarmupTime ) },  //
+              SampleCycle{ Timer::ToTicks( BaseRange::SampleDuration ) },           //
+              PausedCycle{ 0 },                                                     //
+              Warming{ true },                                                      //
+              WarmupCount{ 0 },                                                     //
+              WarmupHistory{},                                                      //
+              SampleCount{ 0 },                                                     //
+              SampleMean{ 0 },                                                      //
+              SampleM2{ 0 },                                                        //
+              Counters{ Policy::Counting && Base.Counting },                        //
+              Resources{}
+        {
+            BenchmarkAllocations::Current() = {};
+            BenchmarkPause::Current()       = {};
+            BenchmarkProcessed::Current()   = {};
+        }
 
         ~Iterator()
         {
-            Base.Result.TotalCycle     = __rdtsc() - StartCycle;
-            Base.Result.TotalIteration = BaseRange::MaxIteration - RemainIteration;
+            // left early through break / return
+            if( BatchSize != 0 )
+            {
+                const auto Now = Timer::Stop();
+                PausedCycle += FromCycles( BenchmarkPause::Take( ToCycles( Now - BatchCycle ) ) );
+                FinishRepetition( Now, TotalIteration + BatchSize - BatchRemain );
+                if( Base.Rendezvous ) Base.Rendezvous->arrive_and_drop();  // nobody waits on us
+            }
+
+            auto&& Result = Base.Result;
+            std::tie( Result.Counters, Result.CounterMask ) = Counters.Read();
+            for( auto&& Repetition : Result.Repetitions )
+                Result.MeasuredIteration += Repetition.TotalIteration;
+            const auto Allocations = BenchmarkAllocations::Current();
+            Result.AllocationCount = Allocations.Count;
+            Result.AllocationBytes = Allocations.Bytes;
+            Result.PeakBytes       = Allocations.Peak;
+            Result.Aggregate();
+            Result.Samples.shrink_to_fit();
+        }
+    };
+
+    auto begin() { return Iterator{ *this }; }
+    auto end() { return Sentinel{}; }
+
+    // one sample per batch, and batches are at least one iteration and mostly one SampleDuration
+    static auto SampleCapacity( const BenchmarkConfig& Config )
+    {
+        const auto PerRepetition = std::min(
+        Config.MaxIteration, static_cast<std::size_t>( Config.MaxTime / SampleDuration ) + 1 );
+        return Config.Repetitions * PerRepetition;
+    }
+
+    // everything the loop records into is allocated up front
+    static auto Prepare( BenchmarkResult& Result, const BenchmarkConfig& Config )
+    {
+        Policy::Storage::Prepare( Result, SampleCapacity( Config ) );
+        Result.Repetitions.reserve( Config.Repetitions );
+    }
+
+    // cost of an empty loop of this policy on this machine, best of a few runs. A cold loop also
+    // pays for the harness's own code and data coming back after every eviction
+    static auto EmptyLoopOverhead( BenchmarkCacheMode Cache = BenchmarkCacheMode::Warm )
+    {
+        auto Measure = []( BenchmarkCacheMode Mode ) {
+            TscTimer::Frequency();
+            const auto Config = BenchmarkConfig{ .MinTime       = std::chrono::milliseconds{ 1 },
+                                                 .MaxTime       = std::chrono::milliseconds{ 10 },
+                                                 .MaxWarmupTime = std::chrono::milliseconds{ 1 },
+                                                 .RelativeError = 0.01,
+                                                 .MaxIteration  = std::size_t{ 1 } << 20,
+                                                 .Repetitions   = 1,
+                                                 .Cache         = Mode };
+            auto Best = std::numeric_limits<double>::max();
+            for( auto Round = 0; Round < 5; ++Round )
+            {
+                auto Probe = BenchmarkResult{};
+                Prepare( Probe, Config );
+                for( [[maybe_unused]] auto _ :
+                     BasicBenchmarkContainer{ Probe, 0.0, Config, false, false } )
+                    asm volatile( "" );
+                Best = std::min( Best, Probe.Cycle() );
+            }
+            return Best;
+        };
+        static const auto Warm = Measure( BenchmarkCacheMode::Warm );
+        if( Cache != BenchmarkCacheMode::Cold ) return Warm;
+        // registered regions change from one benchmark to the next, and flush fast
+        if( ! BenchmarkCache::Regions().empty() ) return Measure( Cache );
+        static const auto Swept = Measure( Cache );
+        return Swept;
+    }
+
+    static auto Open( BenchmarkResult&& NewResult, const BenchmarkConfig& Config )
+    {
+        BenchmarkEnvironment::Apply();
+        auto Resolved = Config.Resolve( BenchmarkDefaults );
+        if constexpr( ! Policy::ColdCache ) Resolved.Cache = BenchmarkCacheMode::Warm;
+        if( Resolved.Cache == BenchmarkCacheMode::Cold )
+        {
+            NewResult.Title += "/cold";
+            NewResult.Cache = BenchmarkCacheMode::Cold;
+            BenchmarkCache::Buffer();
+        }
+        std::clog << "Benchmarking..." << NewResult.Title << "\n";
+        const auto LoopOverhead = EmptyLoopOverhead( Resolved.Cache );
+        BenchmarkPause::Overhead();
+        auto& Result = BenchmarkResults.emplace_back( std::move( NewResult ) );
+        Prepare( Result, Resolved );
+        return BasicBenchmarkContainer{ Result, LoopOverhead, Resolved,
+                                        BenchmarkResults.ShowCounters,
+                                        BenchmarkResults.ShowResources };
+    }
+};
+
+using BenchmarkContainer = BasicBenchmarkContainer<BenchmarkPolicy>;
+
+// Benchmark<BenchmarkLeanPolicy>( "Title" ) picks another configuration
+template <typename Policy = BenchmarkPolicy>
+auto Benchmark( std::string&& BenchmarkTitle, const BenchmarkConfig& Config = {} )
+{
+    return BasicBenchmarkContainer<Policy>::Open( { .Title = " " + BenchmarkTitle }, Config );
+}
+
+// only Body is timed, Setup runs before every iteration with timing paused.
+// When Setup returns a value, Body receives it, and it is also destroyed while paused
+template <std::invocable Setup, typename Body>
+auto Benchmark( std::string&& BenchmarkTitle, Setup&& Prepare, Body&& Function,  //
+                const BenchmarkConfig& Config = {} )
+{
+    using Input = std::invoke_result_t<Setup&>;
+    if constexpr( std::is_void_v<Input> )
+    {
+        for( [[maybe_unused]] auto _ : Benchmark( std::move( BenchmarkTitle ), Config ) )
+        {
+            PauseTiming();
+            Prepare();
+            ResumeTiming();
+            Function();
+        }
+    }
+    else
+    {
+        auto Value = std::optional<Input>{};
+        for( [[maybe_unused]] auto _ : Benchmark( std::move( BenchmarkTitle ), Config ) )
+        {
+            PauseTiming();
+            Value.reset();
+            Value.emplace( Prepare() );
+            ResumeTiming();
+            Function( *Value );
+        }
+    }
+}
+
+// the same body warm and then cold, the summary pairs the two rows
+template <typename Body>
+auto BenchmarkCacheModes( std::string&& BenchmarkTitle, Body&& Function,
+                          BenchmarkConfig Config = {} )
+{
+    for( auto Mode : { BenchmarkCacheMode::Warm, BenchmarkCacheMode::Cold } )
+    {
+        Config.Cache = Mode;
+        for( [[maybe_unused]] auto _ : Benchmark( std::string{ BenchmarkTitle }, Config ) )
+            Function();
+    }
+}
+
+using BenchmarkArgs = std::vector<std::int64_t>;
+
+// Low, Low * Multiplier, Low * Multiplier^2 ... and High itself. A Low of zero or below is
+// followed by 1, since multiplying it would never reach High
+inline auto BenchmarkRange( std::int64_t Low, std::int64_t High, std::int64_t Multiplier = 2 )
+{
+    const auto Step = std::max( Multiplier, std::int64_t{ 2 } );
+    auto Args       = BenchmarkArgs{};
+    if( Low <= 0 && Low < High )
+    {
+        Args.push_back( Low );
+        Low = 1;
+    }
+    for( auto Arg = Low; Arg < High; Arg *= Step )
+    {
+        Args.push_back( Arg );
+        if( Arg > High / Step ) break;  // the next one would pass High, or overflow
+    }
+    Args.push_back( High );
+    return Args;
+}
+
+// every combination, the last list varying fastest
+template <typename... Lists>
+auto BenchmarkCross( const Lists&... ArgLists )
+{
+    using Point = std::array<std::int64_t, sizeof...( Lists )>;
+    auto Points = std::vector<Point>( 1 );
+    auto Extend = [ & ]( std::size_t Dimension, const BenchmarkArgs& Args ) {
+        auto Extended = std::vector<Point>{};
+        for( auto&& Prefix : Points )
+            for( auto Arg : Args )
+            {
+                Extended.push_back( Prefix );
+                Extended.back()[ Dimension ] = Arg;
+            }
+        Points = std::move( Extended );
+    };
+    auto Dimension = std::size_t{ 0 };
+    ( Extend( Dimension++, ArgLists ), ... );
+    return Points;
+}
+
+// one row per point, the body sees the current point through the loop variable
+template <typename Point>
+struct BenchmarkSweep
+{
+    std::string Title;
+    std::vector<Point> Points;
+    BenchmarkConfig Config;
+
+    using Sentinel = BenchmarkContainer::Sentinel;
+
+    struct Iterator
+    {
+        BenchmarkSweep& Sweep;
+        std::size_t Index;
+        std::optional<BenchmarkContainer> Container;
+        std::optional<BenchmarkContainer::Iterator<BenchmarkContainer>> Inner;
+
+        auto operator*() const { return Sweep.Points[ Index ]; }
+        auto operator++() { ++*Inner; }
+        auto operator!=( Sentinel ) { return ( Inner && *Inner != Sentinel{} ) || NextPoint(); }
+
+        [[gnu::noinline]] bool NextPoint()
+        {
+            Inner.reset();
+            Container.reset();
+            if( ++Index >= Sweep.Points.size() ) return false;
+            Open();
+            return *Inner != Sentinel{};
+        }
+
+        auto Open()
+        {
+            auto Args = BenchmarkArgs{};
+            if constexpr( std::is_integral_v<Point> )
+                Args.push_back( Sweep.Points[ Index ] );
+            else
+                Args.assign( Sweep.Points[ Index ].begin(), Sweep.Points[ Index ].end() );
+
+            auto Title = " " + Sweep.Title;
+            for( auto Arg : Args ) Title += "/" + std::to_string( Arg );
+            Container.emplace( BenchmarkContainer::Open(
+            { .Title = std::move( Title ), .Family = Sweep.Title, .Args = std::move( Args ) },
+            Sweep.Config ) );
+            Inner.emplace( *Container );
+        }
+
+        Iterator( BenchmarkSweep& Sweep_ ) : Sweep{ Sweep_ }, Index{ 0 }
+        {
+            if( ! Sweep.Points.empty() ) Open();
         }
     };
 
@@ -118,15 +2653,528 @@ struct BenchmarkContainer
     auto end() { return Sentinel{}; }
 };
 
-auto Benchmark( std::string&& BenchmarkTitle )
+// each thread records into its own slot, padded against false sharing
+// ( 128 bytes as adjacent line prefetchers work on pairs of 64 byte lines )
+struct alignas( 128 ) BenchmarkThreadSlot
+{
+    BenchmarkResult Result;
+};
+
+// runs Function on 1, 2, 4 ... Config.Threads threads ( hardware_concurrency by default ),
+// one row per thread count. Threads are released together from a barrier, and once warm they
+// wait at a second one before every repetition, so that all of them measure the same MinTime.
+// Function may take the thread index as its argument
+template <typename Body>
+auto BenchmarkThreaded( std::string&& BenchmarkTitle, Body&& Function,  //
+                        const BenchmarkConfig& Config = {} )
+{
+    // threads share the last-level cache, one thread's eviction would land in the others' timing
+    auto Resolved    = Config.Resolve( BenchmarkDefaults );
+    Resolved.MaxTime = Resolved.MinTime;
+    Resolved.Cache   = BenchmarkCacheMode::Warm;
+
+    BenchmarkEnvironment::Apply();
+    const auto LoopOverhead = BenchmarkContainer::EmptyLoopOverhead();
+    BenchmarkPause::Overhead();
+    const auto MaxThreads = std::max( Resolved.Threads, std::size_t{ 1 } );
+
+    auto ThreadCounts = std::vector<std::size_t>{};
+    for( auto Count = std::size_t{ 1 }; Count < MaxThreads; Count *= 2 )
+        ThreadCounts.push_back( Count );
+    ThreadCounts.push_back( MaxThreads );
+
+    for( auto ThreadCount : ThreadCounts )
+    {
+        auto Title = " " + BenchmarkTitle + "/threads:" + std::to_string( ThreadCount );
+        std::clog << "Benchmarking..." << Title << "\n";
+
+        auto Slots = std::vector<BenchmarkThreadSlot>( ThreadCount );
+        for( auto&& Slot : Slots ) BenchmarkContainer::Prepare( Slot.Result, Resolved );
+
+        auto StartLine = std::barrier( static_cast<std::ptrdiff_t>( ThreadCount ) );
+        auto WarmLine  = std::barrier( static_cast<std::ptrdiff_t>( ThreadCount ) );
+        auto Run       = [ & ]( std::size_t ThreadIndex ) {
+            BenchmarkEnvironment::PinThread( ThreadIndex );
+            StartLine.arrive_and_wait();
+            for( [[maybe_unused]] auto _ :
+                 BenchmarkContainer{ Slots[ ThreadIndex ].Result, LoopOverhead, Resolved,
+                                     BenchmarkResults.ShowCounters, BenchmarkResults.ShowResources,
+                                     &WarmLine } )
+                if constexpr( std::is_invocable_v<Body&, std::size_t> )
+                    Function( ThreadIndex );
+                else
+                    Function();
+        };
+        {
+            auto Workers = std::vector<std::jthread>{};
+            for( auto ThreadIndex = std::size_t{ 1 }; ThreadIndex < ThreadCount; ++ThreadIndex )
+                Workers.emplace_back( Run, ThreadIndex );
+            Run( 0 );
+        }
+
+        auto& Row = BenchmarkResults.emplace_back( BenchmarkResult{ .Title   = std::move( Title ),
+                                                                    .Family  = BenchmarkTitle,
+                                                                    .Threads = ThreadCount } );
+        for( auto&& Slot : Slots )
+        {
+            const auto& Samples     = Slot.Result.Samples;
+            const auto& Repetitions = Slot.Result.Repetitions;
+            Row.Samples.insert( Row.Samples.end(), Samples.begin(), Samples.end() );
+            if( const auto& Histogram = Slot.Result.Histogram )
+            {
+                if( ! Row.Histogram ) Row.Histogram.emplace( Histogram->Digits );
+                Row.Histogram->Merge( *Histogram );
+            }
+            Row.WarmupIteration += Slot.Result.WarmupIteration;
+            Row.CounterMask |= Slot.Result.CounterMask;
+            Row.Resources += Slot.Result.Resources;
+            Row.BytesProcessed += Slot.Result.BytesProcessed;
+            Row.ItemsProcessed += Slot.Result.ItemsProcessed;
+            Row.MeasuredIteration += Slot.Result.MeasuredIteration;
+            Row.AllocationCount += Slot.Result.AllocationCount;
+            Row.AllocationBytes += Slot.Result.AllocationBytes;
+            Row.PeakBytes += Slot.Result.PeakBytes;
+            for( auto i = std::size_t{ 0 }; i < BenchmarkCounters::Count; ++i )
+                Row.Counters[ i ] += Slot.Result.Counters[ i ];
+            Row.Repetitions.resize( std::max( Row.Repetitions.size(), Repetitions.size() ) );
+            for( auto i = std::size_t{ 0 }; i < Repetitions.size(); ++i )
+            {
+                Row.Repetitions[ i ].TotalCycle += Repetitions[ i ].TotalCycle;
+                Row.Repetitions[ i ].TotalIteration += Repetitions[ i ].TotalIteration;
+            }
+        }
+        Row.Aggregate();
+    }
+}
+
+// lazily started coroutine, resuming its awaiter once it completes
+struct BenchmarkTask
+{
+    struct promise_type
+    {
+        std::coroutine_handle<> Continuation = std::noop_coroutine();
+
+        auto get_return_object()
+        {
+            return BenchmarkTask{ std::coroutine_handle<promise_type>::from_promise( *this ) };
+        }
+        auto initial_suspend() noexcept { return std::suspend_always{}; }
+        auto final_suspend() noexcept
+        {
+            struct Resumer
+            {
+                auto await_ready() noexcept { return false; }
+                auto await_suspend( std::coroutine_handle<promise_type> Handle ) noexcept
+                {
+                    return Handle.promise().Continuation;
+                }
+                auto await_resume() noexcept {}
+            };
+            return Resumer{};
+        }
+        auto return_void() {}
+        auto unhandled_exception() { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> Handle;
+
+    explicit BenchmarkTask( std::coroutine_handle<promise_type> Handle_ ) : Handle{ Handle_ } {}
+    BenchmarkTask( BenchmarkTask&& Other ) noexcept : Handle{ std::exchange( Other.Handle, {} ) } {}
+    ~BenchmarkTask()
+    {
+        if( Handle ) Handle.destroy();
+    }
+
+    auto await_ready() const noexcept { return false; }
+    auto await_suspend( std::coroutine_handle<> Awaiter ) noexcept
+    {
+        Handle.promise().Continuation = Awaiter;
+        return Handle;
+    }
+    auto await_resume() const noexcept {}
+};
+
+// single-threaded run queue. co_await Loop.Schedule() stands for a completion-based operation :
+// the awaiter is suspended and resumed once the loop comes around to it.
+// A user executor provides the same Post / RunOne, RunOne may block until something is ready
+// and returns false once nothing ever will be
+struct BenchmarkEventLoop
+{
+    std::vector<std::coroutine_handle<>> Queue;  // ring, grows only when full
+    std::size_t Head;
+    std::size_t Count;
+
+    BenchmarkEventLoop() : Queue( 64 ), Head{ 0 }, Count{ 0 } {}
+
+    auto Post( std::coroutine_handle<> Handle )
+    {
+        if( Count == Queue.size() )
+        {
+            std::rotate( Queue.begin(), Queue.begin() + Head, Queue.end() );
+            Queue.resize( 2 * Queue.size() );
+            Head = 0;
+        }
+        Queue[ ( Head + Count++ ) % Queue.size() ] = Handle;
+    }
+
+    auto RunOne()
+    {
+        if( Count == 0 ) return false;
+        const auto Handle = Queue[ Head ];
+        Head              = ( Head + 1 ) % Queue.size();
+        --Count;
+        Handle.resume();
+        return true;
+    }
+
+    auto Schedule()
+    {
+        struct Awaiter
+        {
+            BenchmarkEventLoop& Loop;
+            auto await_ready() const noexcept { return false; }
+            auto await_suspend( std::coroutine_handle<> Handle ) { Loop.Post( Handle ); }
+            auto await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+};
+
+// InFlight drivers keep as many operations going, each awaiting Function() again as soon as
+// its previous one completes. One iteration of the loop is one completion, so Latency is the
+// inverse of the completion rate, while Completions keep the latest end-to-end latencies
+// ( those still in flight at the end included ).
+// Those are stamped with unserialized clock reads, a fence per completion would be charged to
+// every operation, and a cycle or two of drift is lost in an end-to-end latency.
+// Function returns an awaitable, and may take the executor as its argument
+template <typename Body, typename Executor = BenchmarkEventLoop>
+auto BenchmarkAsync( std::string&& BenchmarkTitle, Body&& Function, std::size_t InFlight = 1,
+                     const BenchmarkConfig& Config = {}, Executor&& Loop = Executor{} )
+{
+    constexpr auto CompletionCapacity = std::size_t{ 1 } << 16;
+
+    InFlight       = std::max( InFlight, std::size_t{ 1 } );
+    auto Container = BenchmarkContainer::Open( { .Title    = " " + BenchmarkTitle + "/inflight:" +
+                                                             std::to_string( InFlight ),
+                                                 .Family   = BenchmarkTitle,
+                                                 .InFlight = InFlight },
+                                               Config );
+    auto& Completions = Container.Result.Completions;
+    Completions.reserve( CompletionCapacity );
+
+    // the loop advances on completions, whichever driver they resume
+    auto Iteration = Container.begin();
+    auto Running   = Iteration != Container.end();
+    auto Completed = std::size_t{ 0 };
+    auto Drive     = [ & ]() -> BenchmarkTask {
+        while( Running )
+        {
+            const auto Start = TscTimer::Now();
+            if constexpr( std::is_invocable_v<Body&, Executor&> )
+                co_await Function( Loop );
+            else
+                co_await Function();
+            const auto Latency = static_cast<double>( TscTimer::Now() - Start );
+            if( Completions.size() < CompletionCapacity )
+                Completions.push_back( Latency );
+            else
+                Completions[ Completed % CompletionCapacity ] = Latency;
+            ++Completed;
+            ++Iteration;
+            Running = Running && Iteration != Container.end();
+        }
+    };
+
+    auto Drivers = std::vector<BenchmarkTask>{};
+    Drivers.reserve( InFlight );
+    for( auto i = std::size_t{ 0 }; i < InFlight; ++i )
+    {
+        Drivers.push_back( Drive() );
+        Loop.Post( Drivers.back().Handle );
+    }
+
+    // operations still in flight once the loop ends complete before their frames go
+    for( auto&& Driver : Drivers )
+        while( ! Driver.Handle.done() && Loop.RunOne() ) {}
+}
+
+enum class BenchmarkArrival : unsigned char { Constant, Poisson };
+
+// operations are issued on a schedule rather than back to back, and each one's latency runs
+// from when it was meant to start, so a stall is also charged to the operations queued behind
+// it. A closed-loop row measures the capacity first, and without Rates the offered loads are
+// fractions of it, the last one past saturation. Each load lasts MinTime and at least 2000
+// operations, longer when the harness falls behind.
+// The capacity is the lower of the closed-loop throughput and what the open-loop path itself
+// issues back to back, clock reads included, so that the loads below 1.0 are really offered
+template <typename Body>
+auto BenchmarkOpenLoop( std::string&& BenchmarkTitle, Body&& Function,
+                        std::vector<double> Rates = {},
+                        BenchmarkArrival Arrival       = BenchmarkArrival::Constant,
+                        const BenchmarkConfig& Config = {} )
+{
+    // waits for Intended, runs one operation and returns when it completed
+    auto Issue = [ & ]( std::uint64_t Intended ) {
+        while( TscTimer::Start() < Intended ) {}
+        Function();
+        return TscTimer::Stop();
+    };
+
+    for( [[maybe_unused]] auto _ : Benchmark( BenchmarkTitle + "/closed", Config ) ) Function();
+    const auto MinTime = Config.Resolve( BenchmarkDefaults ).MinTime;
+    const auto Seconds = std::chrono::duration<double>( MinTime ).count();
+    auto Random        = std::mt19937_64{ 0x5eed };
+
+    if( Rates.empty() )
+    {
+        const auto Start = TscTimer::Start();
+        auto Issued      = std::size_t{ 0 };
+        for( auto Now = Start; Now - Start < TscTimer::ToTicks( MinTime ) || Issued < 2000; ++Issued )
+            Now = Issue( Now );
+        const auto Issuing  = Issued * TscTimer::Frequency() / ( TscTimer::Stop() - Start );
+        const auto Capacity = std::min( BenchmarkResults.back().Throughput(), Issuing );
+        for( auto Fraction : { 0.1, 0.25, 0.5, 0.75, 0.9, 1.0, 1.1 } )
+            Rates.push_back( Fraction * Capacity );
+    }
+
+    for( auto Rate : Rates )
+    {
+        if( ! ( Rate > 0 ) ) continue;
+        const auto Count  = static_cast<std::size_t>( std::max( Seconds * Rate, 2000.0 ) );
+        const auto Period = TscTimer::Frequency() / Rate;
+
+        auto Title = " " + BenchmarkTitle + "/rate:" + std::to_string( std::llround( Rate ) );
+        std::clog << "Benchmarking..." << Title << "\n";
+        auto& Result = BenchmarkResults.emplace_back( BenchmarkResult{
+        .Title = std::move( Title ), .Family = BenchmarkTitle, .OfferedRate = Rate } );
+
+        // arrivals in ticks from the start, drawn before the clock runs
+        auto Arrivals = std::vector<double>( Count );
+        auto Gap      = std::exponential_distribution<double>{ 1.0 / Period };
+        for( auto i = std::size_t{ 1 }; i < Count; ++i )
+            Arrivals[ i ] =
+            Arrivals[ i - 1 ] + ( Arrival == BenchmarkArrival::Poisson ? Gap( Random ) : Period );
+        if( BenchmarkResults.HistogramDigits > 0 )
+            Result.Histogram.emplace( BenchmarkResults.HistogramDigits );
+        else
+            Result.Samples.resize( Count );
+        Result.Repetitions.reserve( 1 );
+
+        const auto Start = TscTimer::Start();
+        for( auto i = std::size_t{ 0 }; i < Count; ++i )
+        {
+            const auto Intended = Start + static_cast<std::uint64_t>( Arrivals[ i ] );
+            const auto Latency  = static_cast<double>( Issue( Intended ) - Intended );
+            if( Result.Histogram )
+                Result.Histogram->Record( Latency );
+            else
+                Result.Samples[ i ] = Latency;
+        }
+        Result.Repetitions.push_back( { TscTimer::Stop() - Start, Count, false } );
+        Result.MeasuredIteration = Count;
+        Result.Aggregate();
+    }
+}
+
+template <typename Point>
+auto Benchmark( std::string&& BenchmarkTitle,  //
+                std::vector<Point> Points,     //
+                const BenchmarkConfig& Config = {} )
+{
+    return BenchmarkSweep<Point>{ std::move( BenchmarkTitle ), std::move( Points ), Config };
+}
+
+// benchmarks recorded at static initialization and run by BenchmarkMain, in order.
+// Run either receives the opened container, or is left to open its own ( sweeps, threads )
+struct BenchmarkRegistry
+{
+    std::string Title;
+    std::function<void()> Run;
+
+    static auto& Entries()
+    {
+        static auto Registered = std::vector<BenchmarkRegistry>{};
+        return Registered;
+    }
+
+    template <typename Body>
+    static auto Add( std::string Title, Body Function )
+    {
+        if constexpr( std::is_invocable_v<Body&, BenchmarkContainer> )
+            Entries().push_back( { Title, [ Title, Function ]() mutable {
+                                      Function( Benchmark( std::string{ Title } ) );
+                                  } } );
+        else
+            Entries().push_back( { std::move( Title ), std::move( Function ) } );
+        return true;
+    }
+};
+
+// --min-time takes seconds, or a number with an ns / us / ms / s suffix
+auto ParseBenchmarkTime( std::string_view Text ) -> std::optional<std::chrono::nanoseconds>
 {
-    std::cout << "Benchmarking... " << BenchmarkTitle << "\n";
-    BenchmarkResults.push_back( { " " + BenchmarkTitle, 0, 0 } );
-    return BenchmarkContainer{ BenchmarkResults.back() };
+    auto Value  = 0.0;
+    auto Parsed = std::istringstream{ std::string{ Text } };
+    auto Unit   = std::string{};
+    if( ! ( Parsed >> Value ) || Value < 0 ) return std::nullopt;
+    Parsed >> Unit;
+    constexpr std::pair<std::string_view, double> Units[] = {
+    { "ns", 1.0 }, { "us", 1e3 }, { "ms", 1e6 }, { "s", 1e9 }, { "", 1e9 } };
+    for( auto [ Name, Scale ] : Units )
+        if( Unit == Name )
+            return std::chrono::nanoseconds{ static_cast<std::int64_t>( Value * Scale ) };
+    return std::nullopt;
+}
+
+// runs the registered benchmarks that match the options, the result is meant to be returned
+// from main. --filter, --repetitions and --min-time only concern registered benchmarks
+// and the defaults, inline ones are left as they are
+inline auto BenchmarkMain( int argc, char** argv )
+{
+    auto Filter     = std::regex{ "" };
+    auto List       = false;
+    auto ParseWhole = []( std::string_view Text, auto& Number ) {
+        const auto [ End, Error ] = std::from_chars( Text.data(), Text.data() + Text.size(), Number );
+        return Error == std::errc{} && End == Text.data() + Text.size();
+    };
+    for( auto i = 1; i < argc; ++i )
+    {
+        const auto Arg   = std::string_view{ argv[ i ] };
+        const auto Value = Arg.substr( std::min( Arg.find( '=' ), Arg.size() - 1 ) + 1 );
+        auto Valid       = true;
+        if( Arg.starts_with( "--filter=" ) )
+        {
+            try
+            {
+                Filter = std::regex{ std::string{ Value } };
+            }
+            catch( const std::regex_error& )
+            {
+                Valid = false;
+            }
+        }
+        else if( Arg == "--list" )
+            List = true;
+        else if( Arg.starts_with( "--repetitions=" ) )
+        {
+            auto Repetitions = std::size_t{ 0 };
+            Valid            = ParseWhole( Value, Repetitions ) && Repetitions > 0;
+            if( Valid ) BenchmarkDefaults.Repetitions = Repetitions;
+        }
+        else if( Arg.starts_with( "--min-time=" ) )
+        {
+            const auto MinTime = ParseBenchmarkTime( Value );
+            Valid              = MinTime.has_value();
+            if( Valid ) BenchmarkDefaults.MinTime = *MinTime;
+        }
+        else if( Arg.starts_with( "--format=" ) )
+            Valid = BenchmarkResults.ReportTo( Value );
+        else if( Arg.starts_with( "--relative=" ) )
+        {
+            auto& Unit = BenchmarkResults.RelativeUnit;
+            if( Value == "iterations" )
+                Unit = BenchmarkUnit::Iterations;
+            else if( Value == "bytes" )
+                Unit = BenchmarkUnit::Bytes;
+            else if( Value == "items" )
+                Unit = BenchmarkUnit::Items;
+            else
+                Valid = false;
+        }
+        else if( Arg.starts_with( "--pin=" ) )
+        {
+            auto& Core = BenchmarkEnvironment::Current().Core;
+            Valid      = ParseWhole( Value, Core ) && Core >= 0;
+        }
+        else if( Arg == "--realtime" )
+            BenchmarkEnvironment::Current().Realtime = true;
+        else
+            Valid = false;
+
+        if( ! Valid )
+        {
+            std::cerr << "Invalid option : " << Arg << "\n"
+                      << "usage : " << argv[ 0 ]
+                      << " [--filter=<regex>] [--list] [--repetitions=<n>]"
+                         " [--min-time=<time>] [--format=console|json|csv]"
+                         " [--relative=iterations|bytes|items]"
+                         " [--pin=<core>] [--realtime]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    for( auto&& Entry : BenchmarkRegistry::Entries() )
+        if( std::regex_search( Entry.Title, Filter ) )
+        {
+            if( List )
+                std::cout << Entry.Title << '\n';
+            else
+                Entry.Run();
+        }
+    return List ? EXIT_SUCCESS : BenchmarkResults.Finish();
 }
 
 };  // namespace
 
+// records a benchmark without running it :
+// BENCHMARK( PushBack ) { for( auto _ : State ) ... }
+#define BENCHMARK( Name )                                                      \
+    static void Name( BenchmarkContainer State );                               \
+    [[maybe_unused]] static const auto Name##_Registered =                      \
+    BenchmarkRegistry::Add( #Name, Name );                                      \
+    static void Name( BenchmarkContainer State )
+
+#define BENCHMARK_MAIN() \
+    int main( int argc, char** argv ) { return BenchmarkMain( argc, argv ); }
+
+// replaces the global allocation functions, so define BENCHMARK_TRACK_ALLOCATIONS
+// in one translation unit only. Each block carries its size ahead of it;
+// over-aligned allocations keep the default functions and are not counted
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+#include <cstddef>
+#include <new>
+
+void* operator new( std::size_t Size, const std::nothrow_t& ) noexcept
+{
+    auto Block = static_cast<std::max_align_t*>( std::malloc( sizeof( std::max_align_t ) + Size ) );
+    if( Block == nullptr ) return nullptr;
+    *reinterpret_cast<std::size_t*>( Block ) = Size;
+    BenchmarkAllocations::Current().Allocated( Size );
+    return Block + 1;
+}
+
+void operator delete( void* Pointer ) noexcept
+{
+    if( Pointer == nullptr ) return;
+    auto Block = static_cast<std::max_align_t*>( Pointer ) - 1;
+    BenchmarkAllocations::Current().Freed( *reinterpret_cast<std::size_t*>( Block ) );
+    std::free( Block );
+}
+
+void* operator new( std::size_t Size )
+{
+    if( auto Pointer = operator new( Size, std::nothrow ) ) return Pointer;
+    throw std::bad_alloc{};
+}
+
+void* operator new[]( std::size_t Size ) { return operator new( Size ); }
+void operator delete[]( void* Pointer ) noexcept { operator delete( Pointer ); }
+void operator delete( void* Pointer, std::size_t ) noexcept { operator delete( Pointer ); }
+void operator delete[]( void* Pointer, std::size_t ) noexcept { operator delete( Pointer ); }
+
+void* operator new[]( std::size_t Size, const std::nothrow_t& ) noexcept
+{
+    return operator new( Size, std::nothrow );
+}
+
+void operator delete( void* Pointer, const std::nothrow_t& ) noexcept { operator delete( Pointer ); }
+
+void operator delete[]( void* Pointer, const std::nothrow_t& ) noexcept
+{
+    operator delete( Pointer );
+}
+#endif
+
 #endif /* BENCHMARK_H */
 
 
@@ -141,6 +3189,7 @@ struct BigS
 
 int main()
 {
+    BenchmarkResults.ShowCounters = true;
     for( auto _ : Benchmark( "Without Reserve" ) )
     {
         auto v = std::vector<BigS>{};
@@ -157,6 +3206,13 @@ int main()
     {
         for( volatile int i = 0; i < 100; ++i ) { }
     }
+    for( auto _ : Benchmark( "DoNotOptimize increment" ) )
+    {
+        for( int i = 0; i < 100; ++i ) DoNotOptimize( i );
+    }
+    BenchmarkThreaded( "DoNotOptimize increment", [] {
+        for( int i = 0; i < 100; ++i ) DoNotOptimize( i );
+    } );
     for( auto _ : Benchmark( "Random Stuff" ) ) [[maybe_unused]] int a = 0;
     for( auto _ : Benchmark( "What if I have an extremely long title ?" ) ) {}
 
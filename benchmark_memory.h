@@ -0,0 +1,296 @@
+// usage:
+// BenchmarkMemorySuite();  // before the application benchmarks, rows share the summary
+
+#ifndef BENCHMARK_MEMORY_H
+#define BENCHMARK_MEMORY_H
+
+#include "benchmark.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <random>
+
+namespace {
+
+// read, write and copy over whole vectors, four independent ones in flight.
+// Bytes is a multiple of ChunkBytes, Data is aligned to 64 bytes
+#define BENCHMARK_MEMORY_KERNELS( Name, Target, Vector, Load, Store, Xor )                          \
+    struct Name                                                                                     \
+    {                                                                                               \
+        [[gnu::target( Target )]] static void Read( const std::byte* Data, std::size_t Bytes )      \
+        {                                                                                           \
+            auto A = Vector{}, B = Vector{}, C = Vector{}, D = Vector{};                            \
+            for( const auto End = Data + Bytes; Data < End; Data += 4 * sizeof( Vector ) )          \
+            {                                                                                       \
+                A = Xor( A, Load( (const Vector*)Data ) );                                          \
+                B = Xor( B, Load( (const Vector*)Data + 1 ) );                                      \
+                C = Xor( C, Load( (const Vector*)Data + 2 ) );                                      \
+                D = Xor( D, Load( (const Vector*)Data + 3 ) );                                      \
+            }                                                                                       \
+            Sink( Xor( Xor( A, B ), Xor( C, D ) ) );                                                \
+        }                                                                                           \
+        [[gnu::target( Target )]] static void Write( std::byte* Data, std::size_t Bytes )           \
+        {                                                                                           \
+            const auto Value = Vector{};                                                            \
+            for( const auto End = Data + Bytes; Data < End; Data += sizeof( Vector ) )              \
+                Store( (Vector*)Data, Value );                                                      \
+            ClobberMemory();                                                                        \
+        }                                                                                           \
+        [[gnu::target( Target )]] static void Copy( std::byte* To, const std::byte* From,           \
+                                                    std::size_t Bytes )                             \
+        {                                                                                           \
+            for( const auto End = From + Bytes; From < End;                                         \
+                 From += sizeof( Vector ), To += sizeof( Vector ) )                                 \
+                Store( (Vector*)To, Load( (const Vector*)From ) );                                  \
+            ClobberMemory();                                                                        \
+        }                                                                                           \
+    };
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+BENCHMARK_MEMORY_KERNELS( BenchmarkMemorySse2, "sse2", __m128i, _mm_load_si128, _mm_store_si128,
+                          _mm_xor_si128 )
+BENCHMARK_MEMORY_KERNELS( BenchmarkMemoryAvx2, "avx2", __m256i, _mm256_load_si256,
+                          _mm256_store_si256, _mm256_xor_si256 )
+BENCHMARK_MEMORY_KERNELS( BenchmarkMemoryAvx512, "avx512f", __m512i, _mm512_load_si512,
+                          _mm512_store_si512, _mm512_xor_si512 )
+#else
+inline auto BenchmarkMemoryXor( std::uint64_t A, std::uint64_t B ) { return A ^ B; }
+inline auto BenchmarkMemoryLoad( const std::uint64_t* From ) { return *From; }
+inline auto BenchmarkMemoryStore( std::uint64_t* To, std::uint64_t Value ) { *To = Value; }
+BENCHMARK_MEMORY_KERNELS( BenchmarkMemoryScalar, "default", std::uint64_t, BenchmarkMemoryLoad,
+                          BenchmarkMemoryStore, BenchmarkMemoryXor )
+#endif
+
+#undef BENCHMARK_MEMORY_KERNELS
+
+struct BenchmarkMemoryKernels
+{
+    const char* Name;
+    void ( *Read )( const std::byte* Data, std::size_t Bytes );
+    void ( *Write )( std::byte* Data, std::size_t Bytes );
+    void ( *Copy )( std::byte* To, const std::byte* From, std::size_t Bytes );
+
+    // widest vectors the running CPU supports
+    static auto Select()
+    {
+#if defined( __x86_64__ ) || defined( __i386__ )
+        if( __builtin_cpu_supports( "avx512f" ) )
+            return BenchmarkMemoryKernels{ "avx512", BenchmarkMemoryAvx512::Read,
+                                           BenchmarkMemoryAvx512::Write,
+                                           BenchmarkMemoryAvx512::Copy };
+        if( __builtin_cpu_supports( "avx2" ) )
+            return BenchmarkMemoryKernels{ "avx2", BenchmarkMemoryAvx2::Read,
+                                           BenchmarkMemoryAvx2::Write, BenchmarkMemoryAvx2::Copy };
+        return BenchmarkMemoryKernels{ "sse2", BenchmarkMemorySse2::Read, BenchmarkMemorySse2::Write,
+                                       BenchmarkMemorySse2::Copy };
+#else
+        return BenchmarkMemoryKernels{ "scalar", BenchmarkMemoryScalar::Read,
+                                       BenchmarkMemoryScalar::Write, BenchmarkMemoryScalar::Copy };
+#endif
+    }
+};
+
+struct BenchmarkMemoryConfig
+{
+    std::size_t MinBytes{};     // smallest pointer-chasing working set
+    std::size_t MaxBytes{};     // largest one, capped to a quarter of the physical memory
+    std::size_t StreamBytes{};  // per thread, four times the last-level cache by default
+    bool SingleThreaded{};      // leaves out bandwidth on 2, 4 ... all threads
+    BenchmarkConfig Config{};
+};
+
+// machine characterization on top of the harness: pointer-chasing latency from L1 to DRAM
+// and streaming bandwidth, single-threaded and over every thread.
+// Every row lands in BenchmarkResults, next to the application benchmarks
+struct BenchmarkMemory
+{
+    constexpr static auto LineSize   = BenchmarkCache::LineSize;
+    constexpr static auto ChunkBytes = std::size_t{ 64 } << 10;  // bandwidth work per iteration
+
+    // one node per cache line, so that every hop touches a new line
+    struct Node
+    {
+        const Node* Next;
+        std::size_t Order;
+        std::byte Padding[ LineSize - sizeof( const Node* ) - sizeof( std::size_t ) ];
+    };
+
+    struct FreeAligned
+    {
+        auto operator()( void* Pointer ) const { std::free( Pointer ); }
+    };
+
+    template <typename T>
+    static auto Allocate( std::size_t Bytes )
+    {
+        const auto Rounded = ( Bytes + LineSize - 1 ) / LineSize * LineSize;
+        return std::unique_ptr<T[], FreeAligned>{ static_cast<T*>(
+        std::aligned_alloc( LineSize, Rounded ) ) };
+    }
+
+    static auto PhysicalBytes()
+    {
+#if defined( __linux__ )
+        return static_cast<std::size_t>( sysconf( _SC_PHYS_PAGES ) ) *
+               static_cast<std::size_t>( sysconf( _SC_PAGE_SIZE ) );
+#else
+        return std::size_t{ 16 } << 30;
+#endif
+    }
+
+    // a single cycle through every node in random order ( Sattolo ), defeating the prefetchers
+    static auto Chain( Node* Nodes, std::size_t Count )
+    {
+        for( auto i = std::size_t{ 0 }; i < Count; ++i ) Nodes[ i ].Order = i;
+        auto Random = std::mt19937_64{ Count };
+        for( auto i = Count - 1; i > 0; --i )
+        {
+            const auto j = std::uniform_int_distribution<std::size_t>{ 0, i - 1 }( Random );
+            std::swap( Nodes[ i ].Order, Nodes[ j ].Order );
+        }
+        for( auto i = std::size_t{ 0 }; i < Count; ++i )
+            Nodes[ i ].Next = &Nodes[ Nodes[ i ].Order ];
+    }
+
+    // one dependent load per iteration, so the latency of a row is the latency of a hop
+    // ( page walks included beyond what the TLB covers )
+    static auto Latency( const BenchmarkMemoryConfig& Config )
+    {
+        for( auto Bytes : BenchmarkRange( static_cast<std::int64_t>( Config.MinBytes ),
+                                          static_cast<std::int64_t>( Config.MaxBytes ) ) )
+        {
+            const auto Count =
+            std::max( static_cast<std::size_t>( Bytes ) / LineSize, std::size_t{ 2 } );
+            auto Nodes       = Allocate<Node>( Count * sizeof( Node ) );
+            if( ! Nodes ) break;
+            Chain( Nodes.get(), Count );
+
+            auto Current = static_cast<const Node*>( Nodes.get() );
+            // no Args, hop latency against the working set is a staircase, not a complexity
+            for( [[maybe_unused]] auto _ :
+                 BenchmarkContainer::Open( { .Title  = " memory/latency/" + Size( Bytes ),
+                                             .Family = "memory/latency" },
+                                           Config.Config ) )
+            {
+                Current = Current->Next;
+                asm volatile( "" : "+r"( Current ) );
+            }
+        }
+    }
+
+    // every iteration moves the next ChunkBytes of its own stretch of the buffer
+    static auto Bandwidth( const BenchmarkMemoryConfig& Config )
+    {
+        const auto Kernels = BenchmarkMemoryKernels::Select();
+        const auto Threads =
+        Config.SingleThreaded
+        ? std::size_t{ 1 }
+        : std::max( Config.Config.Resolve( BenchmarkDefaults ).Threads, std::size_t{ 1 } );
+        // every thread streams StreamBytes of its own, so that no row fits in a cache,
+        // unless a quarter of the memory cannot hold that many
+        const auto PerThread = std::min( Config.StreamBytes, PhysicalBytes() / 4 / Threads );
+        const auto Stretch   = std::max( PerThread / ChunkBytes, std::size_t{ 2 } ) * ChunkBytes;
+        auto Buffer        = Allocate<std::byte>( Threads * Stretch );
+        if( ! Buffer ) return;
+        std::fill_n( Buffer.get(), Threads * Stretch, std::byte{ 1 } );
+
+        // cursors of different threads never share a line
+        struct alignas( 128 ) Cursor
+        {
+            std::size_t Offset;
+        };
+        auto Cursors = std::vector<Cursor>( Threads );
+
+        auto Kernel = [ & ]( std::string_view Operation ) {
+            return [ &, Operation ]( std::size_t Thread ) {
+                auto& Offset = Cursors[ Thread ].Offset;
+                auto Data    = Buffer.get() + Thread * Stretch;
+                if( Operation == "read" )
+                    Kernels.Read( Data + Offset, ChunkBytes );
+                else if( Operation == "write" )
+                    Kernels.Write( Data + Offset, ChunkBytes );
+                else  // half the stretch is copied onto the other half
+                    Kernels.Copy( Data + Offset / 2, Data + ( Stretch + Offset ) / 2,
+                                  ChunkBytes / 2 );
+                Offset = Offset + ChunkBytes < Stretch ? Offset + ChunkBytes : 0;
+            };
+        };
+
+        auto Streaming              = Config.Config;
+        Streaming.BytesPerIteration = ChunkBytes;  // copies count what they read and write
+        for( auto Operation : { "read", "write", "copy" } )
+        {
+            const auto Title = std::string{ "memory/" } + Operation + "/" + Kernels.Name;
+            auto Run         = Kernel( Operation );
+            Cursors.assign( Threads, Cursor{} );
+            for( [[maybe_unused]] auto _ : BenchmarkContainer::Open(
+                 { .Title = " " + Title, .Family = "memory/bandwidth" }, Streaming ) )
+                Run( 0 );
+            if( Threads > 1 )
+            {
+                auto Threaded    = Streaming;
+                Threaded.Threads = Threads;
+                BenchmarkThreaded( std::string{ Title }, Run, Threaded );
+            }
+        }
+    }
+
+    static auto Size( std::int64_t Bytes ) -> std::string
+    {
+        if( Bytes >= ( std::int64_t{ 1 } << 30 ) && Bytes % ( std::int64_t{ 1 } << 30 ) == 0 )
+            return std::to_string( Bytes >> 30 ) + "GiB";
+        if( Bytes >= ( std::int64_t{ 1 } << 20 ) && Bytes % ( std::int64_t{ 1 } << 20 ) == 0 )
+            return std::to_string( Bytes >> 20 ) + "MiB";
+        if( Bytes >= ( std::int64_t{ 1 } << 10 ) && Bytes % ( std::int64_t{ 1 } << 10 ) == 0 )
+            return std::to_string( Bytes >> 10 ) + "KiB";
+        return std::to_string( Bytes ) + "B";
+    }
+
+    // appended to the console report : latency per working set, bandwidth per thread count
+    static auto Report( const BenchmarkAnalyzer& Results, std::ostream& Out )
+    {
+        auto cout_stats = [ &Out ]( std::string_view Title, const auto&... Columns ) {
+            Out << ' ' << std::left << std::setw( 24 ) << Title << std::right << std::fixed
+                << std::setprecision( 2 );
+            ( ( Out << std::setw( 14 ) << Columns ), ... );
+            Out << '\n';
+        };
+
+        Out << "\n Memory Latency\n";
+        cout_stats( "Working Set", "Hop(ns)" );
+        for( auto&& Result : Results )
+            if( Result.Family == "memory/latency" )
+                cout_stats( Result.Title.substr( Result.Title.rfind( '/' ) + 1 ), Result.Latency() );
+
+        Out << "\n Memory Bandwidth (GB/s)\n";
+        cout_stats( "Kernel", "Threads", "Total", "Per Thread" );
+        for( auto&& Result : Results )
+        {
+            const auto Threaded = Result.Title.starts_with( " memory/" ) && Result.Threads > 0;
+            if( Result.Family != "memory/bandwidth" && ! Threaded ) continue;
+            const auto Threads = std::max( Result.Threads, std::size_t{ 1 } );
+            const auto Total   = Result.Rate( BenchmarkUnit::Bytes ) / 1e9;
+            cout_stats( Result.Title.substr( 8 ), Threads, Total, Total / Threads );
+        }
+    }
+};
+
+inline auto BenchmarkMemorySuite( BenchmarkMemoryConfig Config = {} )
+{
+    const auto Physical = BenchmarkMemory::PhysicalBytes();
+    if( Config.MinBytes == 0 ) Config.MinBytes = std::size_t{ 4 } << 10;
+    if( Config.MaxBytes == 0 ) Config.MaxBytes = std::size_t{ 4 } << 30;
+    Config.MaxBytes = std::max( std::min( Config.MaxBytes, Physical / 4 ), Config.MinBytes );
+    if( Config.StreamBytes == 0 ) Config.StreamBytes = 4 * BenchmarkCache::LastLevelSize();
+    Config.StreamBytes = std::min( Config.StreamBytes, Physical / 8 );
+
+    BenchmarkResults.ConsoleSections.push_back( BenchmarkMemory::Report );
+    BenchmarkMemory::Latency( Config );
+    BenchmarkMemory::Bandwidth( Config );
+}
+
+};  // namespace
+
+#endif /* BENCHMARK_MEMORY_H */
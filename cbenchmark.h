@@ -2,11 +2,20 @@
 #define BENCHMARK_H
 #define CBENCHMARK_H
 
-//#include <immintrin.h>  //__rdtsc
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L  // clock_gettime under strict ISO C
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <x86intrin.h>  //__rdtsc
+#endif
+#include <fcntl.h>
+#include <regex.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,8 +25,56 @@ extern "C" {
 #endif
 #endif
 
-#define MaxIteration 5678
-#define MaxCycle     ( CLOCKS_PER_SEC * 2 )
+// every limit may be overridden by defining it before inclusion
+#ifndef MaxIteration
+#define MaxIteration ( (size_t)1 << 30 )
+#endif
+#ifndef MinCycle
+#define MinCycle ( CLOCKS_PER_SEC / 20 )
+#endif
+#ifndef MaxCycle
+#define MaxCycle ( CLOCKS_PER_SEC * 2 )
+#endif
+#ifndef MaxWarmupCycle
+#define MaxWarmupCycle ( CLOCKS_PER_SEC / 4 )
+#endif
+#ifndef SampleCycle
+#define SampleCycle ( CLOCKS_PER_SEC / 10000 + 1 )
+#endif
+#ifndef WarmupTolerance
+#define WarmupTolerance 0.05
+#endif
+#ifndef MaxRelativeError
+#define MaxRelativeError 0.01
+#endif
+#ifndef MaxResults
+#define MaxResults 256
+#endif
+#ifndef MaxSamples
+#define MaxSamples ( (size_t)1 << 16 )  // shared by every result
+#endif
+#ifndef DefaultClock
+#define DefaultClock BC_MonotonicRaw  // see BenchmarkClock
+#endif
+#ifndef CLOCK_MONOTONIC_RAW
+#define CLOCK_MONOTONIC_RAW CLOCK_MONOTONIC
+#endif
+
+// compiler barriers, no instruction is emitted for any of them
+// DoNotOptimize : Value (an lvalue) is treated as read and modified, pending stores are flushed
+// ClobberMemory : pending stores are flushed and later loads are reissued
+// Sink          : Value (any expression) is consumed, other memory accesses are left alone
+#if defined( __clang__ )
+#define DoNotOptimize( Value ) __asm__ __volatile__( "" : "+r,m"( Value ) : : "memory" )
+#else
+#define DoNotOptimize( Value ) __asm__ __volatile__( "" : "+m,r"( Value ) : : "memory" )
+#endif
+#define ClobberMemory() __asm__ __volatile__( "" : : : "memory" )
+#define Sink( Value )                                  \
+    do {                                               \
+        __typeof__( Value ) Sink_ = ( Value );         \
+        __asm__ __volatile__( "" : : "r,m"( Sink_ ) ); \
+    } while( 0 )
 
 size_t digit_width( long long n )
 {
@@ -27,62 +84,380 @@ size_t digit_width( long long n )
     return 0;
 }
 
+////////////////////////////// BenchmarkAllocations [Class] //////////////////////////////
+////////////////////////////// BenchmarkAllocations [Fields] //////////////////////////////
+// heap activity while a benchmark is measured, fed by the malloc family that is replaced
+// when BENCHMARK_TRACK_ALLOCATIONS is defined (glibc only, in one translation unit).
+// Sizes are as reported by malloc_usable_size, the harness itself allocates
+// outside of measurement only
+typedef struct BenchmarkAllocationsTag
+{
+    size_t Count;
+    size_t Bytes;
+    long long Live;  // above where tracking started
+    long long Peak;
+    bool Tracking;
+} BenchmarkAllocations, *LP_BAL;
+
+////////////////////////////// BenchmarkAllocations [static] ////////////////////////////////////
+static BenchmarkAllocations AllocationTracker = { 0, 0, 0, 0, 0 };
+
+////////////////////////////// BenchmarkAllocations [Methods] //////////////////////////////
+void BAL_Allocated( LP_BAL self, size_t Size )
+{
+    if( ! self->Tracking ) return;
+    ++self->Count;
+    self->Bytes += Size;
+    self->Live += Size;
+    if( self->Peak < self->Live ) self->Peak = self->Live;
+}
+
+void BAL_Freed( LP_BAL self, size_t Size )
+{
+    if( self->Tracking ) self->Live -= Size;
+}
+
+void BAL_PrintPerIteration( LP_BAL self, size_t Iteration )
+{
+    double PerIteration = Iteration ? 1.0 / Iteration : 0;
+    printf( "%12.2f%12.2f%12lld", self->Count * PerIteration, self->Bytes * PerIteration,
+            self->Peak );
+}
+
+void BAL_Reset( LP_BAL self )
+{
+    self->Count    = 0;
+    self->Bytes    = 0;
+    self->Live     = 0;
+    self->Peak     = 0;
+    self->Tracking = 0;
+}
+
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+#include <malloc.h>
+#ifdef __cplusplus
+#define BAL_NoThrow noexcept
+#else
+#define BAL_NoThrow
+#endif
+void* __libc_malloc( size_t Size );
+void* __libc_calloc( size_t Count, size_t Size );
+void* __libc_realloc( void* Block, size_t Size );
+void __libc_free( void* Block );
+
+void* malloc( size_t Size ) BAL_NoThrow
+{
+    void* Block = __libc_malloc( Size );
+    if( Block ) BAL_Allocated( &AllocationTracker, malloc_usable_size( Block ) );
+    return Block;
+}
+
+void* calloc( size_t Count, size_t Size ) BAL_NoThrow
+{
+    void* Block = __libc_calloc( Count, Size );
+    if( Block ) BAL_Allocated( &AllocationTracker, malloc_usable_size( Block ) );
+    return Block;
+}
+
+void* realloc( void* Block, size_t Size ) BAL_NoThrow
+{
+    size_t OldSize = Block ? malloc_usable_size( Block ) : 0;
+    void* NewBlock = __libc_realloc( Block, Size );
+    if( NewBlock || Size == 0 ) BAL_Freed( &AllocationTracker, OldSize );
+    if( NewBlock ) BAL_Allocated( &AllocationTracker, malloc_usable_size( NewBlock ) );
+    return NewBlock;
+}
+
+void free( void* Block ) BAL_NoThrow
+{
+    if( Block ) BAL_Freed( &AllocationTracker, malloc_usable_size( Block ) );
+    __libc_free( Block );
+}
+#endif
+////////////////////////////// BenchmarkAllocations [End] //////////////////////////////
+
+////////////////////////////// BenchmarkClock [Class] //////////////////////////////
+////////////////////////////// BenchmarkClock [Fields] //////////////////////////////
+// time sources : wall time from CLOCK_MONOTONIC_RAW, CPU time of the process or of the calling
+// thread, or the time stamp counter, calibrated against CLOCK_MONOTONIC_RAW (x86 only, wall
+// time elsewhere). Readings are ticks of the source, nanoseconds but for the time stamp counter
+typedef enum BenchmarkClockTag
+{
+    BC_MonotonicRaw,
+    BC_ProcessCpu,
+    BC_ThreadCpu,
+    BC_Tsc,
+    BC_Count
+} BenchmarkClock;
+
+typedef long long BenchmarkTicks;
+
+////////////////////////////// BenchmarkClock [static] ////////////////////////////////////
+static BenchmarkClock BC_Source = DefaultClock;  // times every benchmark that starts after
+static const char* BC_Names[ BC_Count ] = { "monotonic_raw", "process_cputime",
+                                            "thread_cputime", "tsc" };
+
+////////////////////////////// BenchmarkClock [Methods] //////////////////////////////
+BenchmarkTicks BC_Nanoseconds( clockid_t Id )
+{
+    struct timespec Now;
+    clock_gettime( Id, &Now );
+    return Now.tv_sec * 1000000000LL + Now.tv_nsec;
+}
+
+BenchmarkTicks BC_Read( BenchmarkClock Clock )
+{
+    switch( Clock )
+    {
+        case BC_ProcessCpu: return BC_Nanoseconds( CLOCK_PROCESS_CPUTIME_ID );
+        case BC_ThreadCpu: return BC_Nanoseconds( CLOCK_THREAD_CPUTIME_ID );
+#if defined( __x86_64__ ) || defined( __i386__ )
+        case BC_Tsc: return (BenchmarkTicks)__rdtsc();
+#endif
+        default: return BC_Nanoseconds( CLOCK_MONOTONIC_RAW );
+    }
+}
+
+// ticks per second, the time stamp counter is calibrated once, over 20ms
+double BC_Frequency( BenchmarkClock Clock )
+{
+#if defined( __x86_64__ ) || defined( __i386__ )
+    static double TscFrequency = 0;
+    if( Clock == BC_Tsc && TscFrequency == 0 )
+    {
+        BenchmarkTicks Wall = BC_Read( BC_MonotonicRaw ), Tsc = BC_Read( BC_Tsc ), Elapsed;
+        while( ( Elapsed = BC_Read( BC_MonotonicRaw ) - Wall ) < 20000000 ) {}
+        TscFrequency = 1e9 * ( BC_Read( BC_Tsc ) - Tsc ) / Elapsed;
+    }
+    if( Clock == BC_Tsc ) return TscFrequency;
+#else
+    (void)Clock;
+#endif
+    return 1e9;
+}
+
+// limits are given in clock() ticks, CLOCKS_PER_SEC of them per second
+BenchmarkTicks BC_FromClock( clock_t Limit )
+{
+    return (BenchmarkTicks)( (double)Limit / CLOCKS_PER_SEC * BC_Frequency( BC_Source ) );
+}
+
+bool BC_Select( const char* Name )
+{
+    for( int Clock = 0; Clock < BC_Count; ++Clock )
+        if( strcmp( Name, BC_Names[ Clock ] ) == 0 ) return BC_Source = (BenchmarkClock)Clock, 1;
+    return 0;
+}
+////////////////////////////// BenchmarkClock [End] //////////////////////////////
+
+////////////////////////////// BenchmarkResourceUsage [Class] //////////////////////////////
+////////////////////////////// BenchmarkResourceUsage [Fields] //////////////////////////////
+// what the operating system accounts to the calling thread : user and system CPU time,
+// voluntary and involuntary context switches, minor and major page faults (getrusage), and
+// time spent waiting on a run queue (/proc/thread-self/schedstat), times in nanoseconds.
+// Snapshots are taken around the measurement when BENCHMARK_TRACK_RESOURCES is defined
+enum
+{
+    BRU_Count = 7
+};
+
+typedef struct BenchmarkResourceUsageTag
+{
+    double Values[ BRU_Count ];
+} BenchmarkResourceUsage, *LP_BRU;
+
+////////////////////////////// BenchmarkResourceUsage [static] ////////////////////////////////////
+// the names are only printed with BENCHMARK_TRACK_RESOURCES
+static const char* BRU_Names[ BRU_Count ] __attribute__( ( unused ) ) = {
+    "User(ns)", "System(ns)", "VolCS", "InvolCS", "MinFlt", "MajFlt", "RunQueue(ns)" };
+static const char* BRU_Keys[ BRU_Count ] = { "user_ns", "system_ns", "voluntary_switches",
+                                             "involuntary_switches", "minor_faults",
+                                             "major_faults", "run_queue_ns" };
+
+////////////////////////////// BenchmarkResourceUsage [Methods] //////////////////////////////
+BenchmarkResourceUsage BRU_Snapshot( void )
+{
+    BenchmarkResourceUsage Usage;
+    struct rusage Accounted;
+    char Schedstat[ 64 ];  // read without stdio, which would allocate its buffer
+    char* Waiting;
+    ssize_t Length;
+    int File;
+#ifdef RUSAGE_THREAD
+    int Who = RUSAGE_THREAD;
+#else
+    int Who = RUSAGE_SELF;  // without _GNU_SOURCE, the whole process
+#endif
+    memset( &Usage, 0, sizeof( Usage ) );
+    if( getrusage( Who, &Accounted ) == 0 )
+    {
+        Usage.Values[ 0 ] = Accounted.ru_utime.tv_sec * 1e9 + Accounted.ru_utime.tv_usec * 1e3;
+        Usage.Values[ 1 ] = Accounted.ru_stime.tv_sec * 1e9 + Accounted.ru_stime.tv_usec * 1e3;
+        Usage.Values[ 2 ] = Accounted.ru_nvcsw;
+        Usage.Values[ 3 ] = Accounted.ru_nivcsw;
+        Usage.Values[ 4 ] = Accounted.ru_minflt;
+        Usage.Values[ 5 ] = Accounted.ru_majflt;
+    }
+
+    File = open( "/proc/thread-self/schedstat", O_RDONLY );
+    if( File < 0 ) return Usage;
+    Length = read( File, Schedstat, sizeof( Schedstat ) - 1 );
+    close( File );
+    if( Length <= 0 ) return Usage;
+
+    // time on the CPU, then time waiting for it
+    Schedstat[ Length ] = '\0';
+    strtoull( Schedstat, &Waiting, 10 );
+    if( Waiting != Schedstat ) Usage.Values[ 6 ] = (double)strtoull( Waiting, NULL, 10 );
+    return Usage;
+}
+
+BenchmarkResourceUsage BRU_Since( BenchmarkResourceUsage Start )
+{
+    BenchmarkResourceUsage Usage = BRU_Snapshot();
+    for( int i = 0; i < BRU_Count; ++i ) Usage.Values[ i ] -= Start.Values[ i ];
+    return Usage;
+}
+
+void BRU_PrintPerIteration( LP_BRU self, size_t Iteration )
+{
+    for( int i = 0; i < BRU_Count; ++i )
+        printf( "%13.4g", Iteration ? self->Values[ i ] / Iteration : 0 );
+}
+////////////////////////////// BenchmarkResourceUsage [End] //////////////////////////////
+
 ////////////////////////////// BenchmarkResultNode [Class] //////////////////////////////
 ////////////////////////////// BenchmarkResultNode [Fields] /////////////////////////////////
 typedef struct BenchmarkResultNodeTag
 {
     const char* Title;
-    clock_t TotalCycle;
+    BenchmarkClock Clock;
+    BenchmarkTicks TotalCycle;
     size_t TotalIteration;
-    struct BenchmarkResultNodeTag* Next;
+    long long CpuNanoseconds;  // of the calling thread
+    BenchmarkAllocations Allocations;
+    BenchmarkResourceUsage Resources;
+    double* Samples;  // ticks per iteration of every measured batch, net and sorted
+    size_t SampleCount;
 } BenchmarkResultNode, *LP_BRN;
 
+////////////////////////////// BenchmarkResultNode [static] ////////////////////////////////////
+// results and their samples are kept in static storage, one after another, so that running a
+// benchmark never touches the heap. Both are released with the analyser
+static BenchmarkResultNode ResultArena[ MaxResults ];
+static size_t ResultArenaUsed = 0;
+static double SampleArena[ MaxSamples ];
+static size_t SampleArenaUsed = 0;
+
 ////////////////////////////// BenchmarkResultNode [Methods] /////////////////////////////////
-size_t BRN_Latency( LP_BRN self ) { return self->TotalCycle / self->TotalIteration; }
+// in nanoseconds per iteration
+double BRN_Latency( LP_BRN self )
+{
+    if( self->TotalIteration == 0 ) return 0;
+    return 1e9 * self->TotalCycle / BC_Frequency( self->Clock ) / self->TotalIteration;
+}
+
+double BRN_CpuLatency( LP_BRN self )
+{
+    return self->TotalIteration ? (double)self->CpuNanoseconds / self->TotalIteration : 0;
+}
 
 size_t BRN_Throughput( LP_BRN self )
 {
-    return self->TotalCycle ? CLOCKS_PER_SEC * self->TotalIteration / self->TotalCycle : 0;
+    if( self->TotalCycle == 0 ) return 0;
+    return (size_t)( BC_Frequency( self->Clock ) * self->TotalIteration / self->TotalCycle );
 }
 
-LP_BRN BRN_New( const char* Title, clock_t TotalCycle, size_t TotalIteration )
+LP_BRN BRN_New( const char* Title, BenchmarkTicks TotalCycle, size_t TotalIteration )
 {
-    LP_BRN self = (LP_BRN)malloc( sizeof( BenchmarkResultNode ) );
-    if( self == NULL )
+    if( ResultArenaUsed == MaxResults )
     {
-        puts( "BenchmarkResultNode Construction Failed" );
+        puts( "BenchmarkResultNode Construction Failed, raise MaxResults" );
         getchar();
         exit( EXIT_FAILURE );
     }
+    LP_BRN self          = &ResultArena[ ResultArenaUsed++ ];
     self->Title          = Title;
+    self->Clock          = BC_Source;
     self->TotalCycle     = TotalCycle;
     self->TotalIteration = TotalIteration;
-    self->Next           = NULL;
+    self->CpuNanoseconds = 0;
+    BAL_Reset( &self->Allocations );
+    memset( &self->Resources, 0, sizeof( self->Resources ) );
+    self->Samples        = NULL;
+    self->SampleCount    = 0;
+    return self;
+}
+
+LP_BRN BRN_WithAllocations( LP_BRN self, BenchmarkAllocations Allocations )
+{
+    self->Allocations = Allocations;
+    return self;
+}
+
+LP_BRN BRN_WithCpuTime( LP_BRN self, long long CpuNanoseconds )
+{
+    self->CpuNanoseconds = CpuNanoseconds;
+    return self;
+}
+
+LP_BRN BRN_WithResources( LP_BRN self, BenchmarkResourceUsage Resources )
+{
+    self->Resources = Resources;
     return self;
 }
 
+// sorted in place, shell sort with Ciura's gaps rather than qsort, which may allocate
+LP_BRN BRN_WithSamples( LP_BRN self, double* Samples, size_t SampleCount )
+{
+    static const size_t Gaps[] = { 701, 301, 132, 57, 23, 10, 4, 1 };
+    for( size_t g = 0; g < sizeof( Gaps ) / sizeof( Gaps[ 0 ] ); ++g )
+        for( size_t i = Gaps[ g ]; i < SampleCount; ++i )
+        {
+            double Sample = Samples[ i ];
+            size_t j      = i;
+            for( ; j >= Gaps[ g ] && Samples[ j - Gaps[ g ] ] > Sample; j -= Gaps[ g ] )
+                Samples[ j ] = Samples[ j - Gaps[ g ] ];
+            Samples[ j ] = Sample;
+        }
+    self->Samples     = Samples;
+    self->SampleCount = SampleCount;
+    return self;
+}
+
+// in nanoseconds per iteration, nearest rank
+double BRN_Percentile( LP_BRN self, double Rank )
+{
+    if( self->SampleCount == 0 ) return 0;
+    size_t Index = (size_t)( Rank * ( self->SampleCount - 1 ) + 0.5 );
+    return 1e9 * self->Samples[ Index ] / BC_Frequency( self->Clock );
+}
+
 ////////////////////////////// BenchmarkResultNode [End] //////////////////////////////
 
 ////////////////////////////// BenchmarkAnalyser [Class] //////////////////////////////
 ////////////////////////////// BenchmarkAnalyser [Fields] //////////////////////////////
 typedef struct BenchmarkAnalyserTag
 {
-    LP_BRN ListHead, ListTail;
-    size_t TitleWidth, LatencyWidth, ThroughputWidth;
+    LP_BRN Results;  // one after another in ResultArena
+    size_t ResultCount;
+    size_t TitleWidth, LatencyWidth, CpuWidth, ThroughputWidth;
+    void ( *Reporter )( struct BenchmarkAnalyserTag* self, FILE* Out );  // see BA_ReportTo
+    const char* ReportPath;
+    bool Enabled;  // released by EnableBenchmark() rather than the first Benchmark
 } BenchmarkAnalyser, *LP_BA;
 
 ////////////////////////////// BenchmarkAnalyser [static] ////////////////////////////////////
-static BenchmarkAnalyser BenchmarkResults = { NULL, NULL,
+static BenchmarkAnalyser BenchmarkResults = { NULL, 0,
                                               strlen( "/_____________________/" ) + 6,
-                                              strlen( "Latency" ), strlen( "Throughput" ) + 5 };
+                                              strlen( "Latency(ns)" ), strlen( "CPU(ns)" ) + 5,
+                                              strlen( "Throughput" ) + 5,
+                                              NULL, NULL, 0 };
 
 ////////////////////////////// BenchmarkAnalyser [Methods] //////////////////////////////
 void BA_PushBack( LP_BA self, LP_BRN NewNode )
 {
-    if( self->ListHead == NULL )  // new container
-        self->ListTail = self->ListHead = NewNode;
-    else
-        self->ListTail = self->ListTail->Next = NewNode;
+    if( self->ResultCount++ == 0 ) self->Results = NewNode;  // the rest follow it
 
 #define UpdateMaxValue( A, B ) \
     do {                       \
@@ -91,14 +466,22 @@ void BA_PushBack( LP_BA self, LP_BRN NewNode )
     } while( 0 )
 
     UpdateMaxValue( self->TitleWidth, strlen( NewNode->Title ) );
-    UpdateMaxValue( self->LatencyWidth, digit_width( BRN_Latency( NewNode ) ) );
+    UpdateMaxValue( self->LatencyWidth, digit_width( (long long)BRN_Latency( NewNode ) ) + 3 );
+    UpdateMaxValue( self->CpuWidth, digit_width( (long long)BRN_CpuLatency( NewNode ) ) + 3 );
     UpdateMaxValue( self->ThroughputWidth, digit_width( BRN_Throughput( NewNode ) ) );
 }
 
 void BA_PrintHorizontalLine( LP_BA self )
 {
     putchar( '\n' );
-    size_t LineWidth = self->TitleWidth + self->LatencyWidth + self->ThroughputWidth;
+    size_t LineWidth =
+    self->TitleWidth + self->LatencyWidth + self->CpuWidth + self->ThroughputWidth;
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+    LineWidth += 3 * 12;
+#endif
+#ifdef BENCHMARK_TRACK_RESOURCES
+    LineWidth += BRU_Count * 13;
+#endif
     for( size_t i = 0; i <= LineWidth; ++i ) putchar( '_' );
     putchar( '\n' );
 }
@@ -110,31 +493,173 @@ void BA_PrintSummaryHeader( LP_BA self )
             "\n  /  Benchmark Summary  /" );
     //      "\n /_____________________/"
     printf( "\n %-*s", (int)self->TitleWidth, "/_____________________/" );
-    printf( "%*s", (int)self->LatencyWidth, "Latency" );
+    printf( "%*s", (int)self->LatencyWidth, "Latency(ns)" );
+    printf( "%*s", (int)self->CpuWidth, "CPU(ns)" );
     printf( "%*s", (int)self->ThroughputWidth, "Throughput" );
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+    printf( "%12s%12s%12s", "Allocs/it", "Bytes/it", "PeakBytes" );
+#endif
+#ifdef BENCHMARK_TRACK_RESOURCES
+    for( int i = 0; i < BRU_Count; ++i ) printf( "%13s", BRU_Names[ i ] );
+#endif
     BA_PrintHorizontalLine( self );
 }
 
 void BA_PrintSummaryLine( LP_BA self, LP_BRN BRNode )
 {
     printf( "\n %-*s", (int)self->TitleWidth, BRNode->Title );
-    printf( "%*d", (int)self->LatencyWidth, (int)BRN_Latency( BRNode ) );
-    printf( "%*d", (int)self->ThroughputWidth, (int)BRN_Throughput( BRNode ) );
+    printf( "%*.2f", (int)self->LatencyWidth, BRN_Latency( BRNode ) );
+    printf( "%*.2f", (int)self->CpuWidth, BRN_CpuLatency( BRNode ) );
+    printf( "%*zu", (int)self->ThroughputWidth, BRN_Throughput( BRNode ) );
+#ifdef BENCHMARK_TRACK_ALLOCATIONS
+    BAL_PrintPerIteration( &BRNode->Allocations, BRNode->TotalIteration );
+#endif
+#ifdef BENCHMARK_TRACK_RESOURCES
+    BRU_PrintPerIteration( &BRNode->Resources, BRNode->TotalIteration );
+#endif
+}
+
+// machine readable reports, written ahead of the console table, times in nanoseconds
+void BA_PrintJSONString( FILE* Out, const char* Text )
+{
+    fputc( '"', Out );
+    for( ; *Text; ++Text )
+        if( *Text == '"' || *Text == '\\' )
+            fprintf( Out, "\\%c", *Text );
+        else if( (unsigned char)*Text < 0x20 )
+            fprintf( Out, "\\u%04x", *Text );
+        else
+            fputc( *Text, Out );
+    fputc( '"', Out );
+}
+
+void BA_PrintCSVString( FILE* Out, const char* Text )
+{
+    fputc( '"', Out );
+    for( ; *Text; ++Text )
+    {
+        if( *Text == '"' ) fputc( '"', Out );
+        fputc( *Text, Out );
+    }
+    fputc( '"', Out );
+}
+
+// a result without samples has no percentiles, Missing is written instead of a number
+void BA_PrintPercentile( FILE* Out, LP_BRN Node, double Rank, const char* Missing )
+{
+    if( Node->SampleCount )
+        fprintf( Out, "%.10g", BRN_Percentile( Node, Rank ) );
+    else
+        fputs( Missing, Out );
+}
+
+double BRN_PerIteration( LP_BRN self, size_t Total )
+{
+    return self->TotalIteration ? (double)Total / self->TotalIteration : 0;
+}
+
+void BA_ReportJSON( LP_BA self, FILE* Out )
+{
+    char Date[ 32 ] = "";
+    time_t Now      = time( NULL );
+    strftime( Date, sizeof( Date ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &Now ) );
+    fprintf( Out,
+             "{\n  \"host\": { \"clock\": \"%s\", \"ticks_per_sec\": %.10g, \"date\": \"%s\" },",
+             BC_Names[ BC_Source ], BC_Frequency( BC_Source ), Date );
+    fprintf( Out, "\n  \"benchmarks\": [" );
+    for( LP_BRN Node = self->Results; Node < self->Results + self->ResultCount; ++Node )
+    {
+        fprintf( Out, "%s\n    { \"title\": ", Node == self->Results ? "" : "," );
+        BA_PrintJSONString( Out, Node->Title );
+        fprintf( Out,
+                 ", \"iterations\": %zu, \"cycles\": %lld, \"ns\": %.10g, \"cpu_ns\": %.10g"
+                 ", \"throughput\": %zu",
+                 Node->TotalIteration, Node->TotalCycle, BRN_Latency( Node ),
+                 BRN_CpuLatency( Node ), BRN_Throughput( Node ) );
+        fprintf( Out, ", \"samples\": %zu, \"median_ns\": ", Node->SampleCount );
+        BA_PrintPercentile( Out, Node, 0.5, "null" );
+        fprintf( Out, ", \"p99_ns\": " );
+        BA_PrintPercentile( Out, Node, 0.99, "null" );
+        fprintf( Out,
+                 ", \"allocations\": %.10g, \"allocated_bytes\": %.10g, \"peak_bytes\": %lld",
+                 BRN_PerIteration( Node, Node->Allocations.Count ),
+                 BRN_PerIteration( Node, Node->Allocations.Bytes ), Node->Allocations.Peak );
+        fprintf( Out, ", \"resources\": {" );
+        for( int i = 0; i < BRU_Count; ++i )
+            fprintf( Out, "%s\"%s\": %.10g", i ? ", " : " ", BRU_Keys[ i ],
+                     Node->TotalIteration ? Node->Resources.Values[ i ] / Node->TotalIteration : 0 );
+        fprintf( Out, " } }" );
+    }
+    fprintf( Out, "\n  ]\n}\n" );
+}
+
+void BA_ReportCSV( LP_BA self, FILE* Out )
+{
+    fprintf( Out, "title,iterations,cycles,ns,cpu_ns,median_ns,p99_ns,throughput,"
+                  "allocations,allocated_bytes,peak_bytes" );
+    for( int i = 0; i < BRU_Count; ++i ) fprintf( Out, ",%s", BRU_Keys[ i ] );
+    fputc( '\n', Out );
+    for( LP_BRN Node = self->Results; Node < self->Results + self->ResultCount; ++Node )
+    {
+        BA_PrintCSVString( Out, Node->Title );
+        fprintf( Out, ",%zu,%lld,%.10g,%.10g,", Node->TotalIteration, Node->TotalCycle,
+                 BRN_Latency( Node ), BRN_CpuLatency( Node ) );
+        BA_PrintPercentile( Out, Node, 0.5, "" );
+        fputc( ',', Out );
+        BA_PrintPercentile( Out, Node, 0.99, "" );
+        fprintf( Out, ",%zu,%.10g,%.10g,%lld", BRN_Throughput( Node ),
+                 BRN_PerIteration( Node, Node->Allocations.Count ),
+                 BRN_PerIteration( Node, Node->Allocations.Bytes ), Node->Allocations.Peak );
+        for( int i = 0; i < BRU_Count; ++i )
+            fprintf( Out, ",%.10g",
+                     Node->TotalIteration ? Node->Resources.Values[ i ] / Node->TotalIteration : 0 );
+        fputc( '\n', Out );
+    }
+}
+
+// Format is "json" or "csv", returns 0 for an unknown format. Without a Path the report
+// replaces the console summary on stdout, progress lines go to stderr either way
+bool BA_ReportTo( LP_BA self, const char* Format, const char* Path )
+{
+    if( strcmp( Format, "json" ) == 0 )
+        self->Reporter = BA_ReportJSON;
+    else if( strcmp( Format, "csv" ) == 0 )
+        self->Reporter = BA_ReportCSV;
+    else
+        return 0;
+    self->ReportPath = Path;
+    return 1;
+}
+
+void BA_Report( LP_BA self )
+{
+    if( self->Reporter == NULL ) return;
+    FILE* Out = self->ReportPath ? fopen( self->ReportPath, "w" ) : stdout;
+    if( Out == NULL )
+    {
+        fprintf( stderr, "\nCannot write report to %s\n", self->ReportPath );
+        return;
+    }
+    self->Reporter( self, Out );
+    if( Out != stdout ) fclose( Out );
 }
 
 void BA_Release( LP_BA self )
 {
     if( ! self ) return;
-    BA_PrintSummaryHeader( self );
-    self->ListTail = NULL;
-    while( self->ListHead )
+    BA_Report( self );
+    if( self->Reporter == NULL || self->ReportPath )
     {
-        LP_BRN OldListHead = self->ListHead;
-        self->ListHead     = self->ListHead->Next;
-        BA_PrintSummaryLine( self, OldListHead );
-        free( OldListHead );
+        BA_PrintSummaryHeader( self );
+        for( size_t i = 0; i < self->ResultCount; ++i )
+            BA_PrintSummaryLine( self, &self->Results[ i ] );
+        BA_PrintHorizontalLine( self );
     }
-    BA_PrintHorizontalLine( self );
+    self->Results     = NULL;
+    self->ResultCount = 0;
+    self->Enabled     = 0;
+    ResultArenaUsed   = 0;
+    SampleArenaUsed   = 0;
 }
 
 void BenchmarkAnalyser_IndirectRelease( LP_BA* IndirectPtr ) { BA_Release( *IndirectPtr ); }
@@ -144,10 +669,239 @@ void BenchmarkAnalyser_IndirectRelease( LP_BA* IndirectPtr ) { BA_Release( *Indi
 ////////////////////////////// BenchmarkModulator [Fields] //////////////////////////////
 typedef struct BenchmarkModulatorTag
 {
-    clock_t StartTime;
-    clock_t TotalCycle;
+    BenchmarkTicks StartTime;  // of BC_Source
+    BenchmarkTicks BatchTime;
+    BenchmarkTicks TotalCycle;
+    long long CpuStart;  // thread CPU time, over the measurement only
+    long long CpuNanoseconds;
     size_t TotalIteration;
-} BenchmarkModulator;
+    size_t BatchSize;
+    size_t BatchRemain;
+    bool Warming;
+    double LastSample;  // warmup drift reference
+    size_t SampleCount;  // running mean / variance of the measured batches
+    double SampleMean;
+    double SampleM2;
+    BenchmarkAllocations Allocations;  // of the measurement, once it is over
+    BenchmarkResourceUsage Resources;  // snapshot at its start, usage once it is over
+    double* Samples;  // of the measurement, in SampleArena
+    size_t Recorded;  // of them, fewer than SampleCount once the arena is full
+} BenchmarkModulator, *LP_BM;
+
+////////////////////////////// BenchmarkModulator [Methods] //////////////////////////////
+BenchmarkModulator BM_Start( void )
+{
+    BenchmarkModulator Mod;
+    LP_BM self = &Mod;
+    self->StartTime      = BC_Read( BC_Source );
+    self->BatchTime      = self->StartTime;
+    self->TotalCycle     = 0;
+    self->CpuStart       = 0;
+    self->CpuNanoseconds = 0;
+    self->TotalIteration = 0;
+    self->BatchSize      = 1;
+    self->BatchRemain    = 1;
+    self->Warming        = 1;
+    self->LastSample     = 0;
+    self->SampleCount    = 0;
+    self->SampleMean     = 0;
+    self->SampleM2       = 0;
+    BAL_Reset( &self->Allocations );
+    BAL_Reset( &AllocationTracker );
+    memset( &self->Resources, 0, sizeof( self->Resources ) );
+    self->Samples        = NULL;
+    self->Recorded       = 0;
+    return Mod;
+}
+
+// BC_Source is only read between batches, batches double until they span SampleCycle.
+// Batches run in two phases : warmup, excluded from the result, ends once two consecutive
+// batches agree within WarmupTolerance; measurement ends once the 95% confidence interval
+// of the mean is within MaxRelativeError, bounded by MinCycle and MaxCycle
+// MinCycle and MaxCycle as in effect, BenchmarkMain may raise them from the command line
+static clock_t BM_MinCycle = MinCycle;
+static clock_t BM_MaxCycle = MaxCycle;
+
+bool BM_Converged( LP_BM self )
+{
+    if( self->SampleCount < 16 ) return 0;
+    double Variance = self->SampleM2 / ( self->SampleCount - 1 ) / self->SampleCount;
+    double Bound    = MaxRelativeError * self->SampleMean;
+    return 1.96 * 1.96 * Variance <= Bound * Bound;
+}
+
+// the measurement starts once its snapshots are taken, returns that time
+BenchmarkTicks BM_StartMeasurement( LP_BM self )
+{
+    self->Warming        = 0;
+    self->TotalIteration = 0;
+#ifdef BENCHMARK_TRACK_RESOURCES
+    self->Resources = BRU_Snapshot();
+#endif
+    self->CpuStart  = BC_Nanoseconds( CLOCK_THREAD_CPUTIME_ID );
+    self->Samples   = &SampleArena[ SampleArenaUsed ];
+    self->StartTime = BC_Read( BC_Source );
+    AllocationTracker.Tracking = 1;
+    return self->StartTime;
+}
+
+void BM_StopMeasurement( LP_BM self )
+{
+    if( ! AllocationTracker.Tracking ) return;
+    self->CpuNanoseconds       = BC_Nanoseconds( CLOCK_THREAD_CPUTIME_ID ) - self->CpuStart;
+    AllocationTracker.Tracking = 0;
+    self->Allocations          = AllocationTracker;
+    self->Allocations.Tracking = 0;
+#ifdef BENCHMARK_TRACK_RESOURCES
+    self->Resources = BRU_Since( self->Resources );
+#endif
+}
+
+void BM_Reverse( double* First, double* Last )
+{
+    for( ; First + 1 < Last; ++First )
+    {
+        double Swap = *First;
+        *First      = *--Last;
+        *Last       = Swap;
+    }
+}
+
+// a Benchmark nested in this one's body appends its samples after ours, the two runs swap places
+// so that each result keeps one slice of SampleArena. Results pointing into the moved run follow
+void BM_Reclaim( LP_BM self )
+{
+    double* Own = self->Samples;
+    double* End = Own + self->Recorded;
+    double* Top = &SampleArena[ SampleArenaUsed ];
+    if( Own == NULL || End == Top ) return;
+    BM_Reverse( Own, End );
+    BM_Reverse( End, Top );
+    BM_Reverse( Own, Top );
+    for( size_t i = 0; i < ResultArenaUsed; ++i )
+    {
+        LP_BRN Node = &ResultArena[ i ];
+        if( Node->Samples && Node->Samples >= End && Node->Samples < Top )
+            Node->Samples -= self->Recorded;
+    }
+    self->Samples = Top - self->Recorded;
+}
+
+bool BM_NextBatch( LP_BM self )
+{
+    BenchmarkTicks Now        = BC_Read( BC_Source );
+    BenchmarkTicks BatchTotal = Now - self->BatchTime;
+    double Sample             = (double)BatchTotal / self->BatchSize;
+    bool Growing              = BatchTotal < BC_FromClock( SampleCycle );
+    self->TotalIteration += self->BatchSize;
+
+    if( self->Warming )
+    {
+        double Drift = Sample > self->LastSample ? Sample - self->LastSample
+                                                 : self->LastSample - Sample;
+        bool Settled = ! Growing && self->LastSample > 0 &&
+                       Drift <= WarmupTolerance * self->LastSample;
+        self->LastSample = Growing ? 0 : Sample;
+        if( Settled || Now - self->StartTime >= BC_FromClock( MaxWarmupCycle ) )
+            Now = BM_StartMeasurement( self );
+    }
+    else
+    {
+        double Delta = Sample - self->SampleMean;
+        self->SampleMean += Delta / ++self->SampleCount;
+        self->SampleM2 += Delta * ( Sample - self->SampleMean );
+        BM_Reclaim( self );
+        if( SampleArenaUsed < MaxSamples )
+        {
+            SampleArena[ SampleArenaUsed++ ] = Sample;
+            ++self->Recorded;
+        }
+
+        self->TotalCycle = Now - self->StartTime;
+        if( self->TotalIteration >= MaxIteration ||
+            self->TotalCycle >= BC_FromClock( BM_MaxCycle ) ||
+            ( self->TotalCycle >= BC_FromClock( BM_MinCycle ) && BM_Converged( self ) ) )
+        {
+            BM_StopMeasurement( self );
+            return self->BatchSize = 0, 0;
+        }
+    }
+
+    // never past the iteration cap or what the remaining time of the phase affords
+    BenchmarkTicks Limit   = BC_FromClock( self->Warming ? MaxWarmupCycle : BM_MaxCycle );
+    BenchmarkTicks Elapsed = Now - self->StartTime;
+    double Affordable =
+    Sample > 0 && Elapsed < Limit ? ( Limit - Elapsed ) / Sample : (double)MaxIteration;
+    size_t NextSize = Growing ? self->BatchSize * 2 : self->BatchSize;
+    if( NextSize > MaxIteration - self->TotalIteration )
+        NextSize = MaxIteration - self->TotalIteration;
+    if( NextSize > Affordable ) NextSize = Affordable >= 1 ? (size_t)Affordable : 1;
+
+    self->BatchSize   = NextSize;
+    self->BatchRemain = NextSize - 1;
+    self->BatchTime   = Now;
+    return 1;
+}
+
+bool BM_Alive( LP_BM self )
+{
+    if( self->BatchRemain == 0 ) return BM_NextBatch( self );
+    --self->BatchRemain;
+    return 1;
+}
+
+// ticks of BC_Source per iteration spent in an empty loop on this machine
+double BM_LoopOverhead( void )
+{
+    static double Overheads[ BC_Count ] = { -1, -1, -1, -1 };
+    double* Overhead = &Overheads[ BC_Source ];
+    if( *Overhead < 0 )
+    {
+        size_t SamplesUsed       = SampleArenaUsed;
+        BenchmarkModulator Probe = BM_Start();
+        while( BM_Alive( &Probe ) ) __asm__ __volatile__( "" );
+        SampleArenaUsed = SamplesUsed;
+        *Overhead = Probe.TotalIteration ? (double)Probe.TotalCycle / Probe.TotalIteration : 0;
+    }
+    return *Overhead;
+}
+
+BenchmarkTicks BM_NetCycle( LP_BM self )
+{
+    BenchmarkTicks Overhead = (BenchmarkTicks)( BM_LoopOverhead() * self->TotalIteration );
+    return self->TotalCycle > Overhead ? self->TotalCycle - Overhead : 0;
+}
+
+// the loop overhead is taken as spent on the CPU
+long long BM_NetCpu( LP_BM self )
+{
+    long long Overhead = (long long)( BM_LoopOverhead() * self->TotalIteration * 1e9 /
+                                      BC_Frequency( BC_Source ) );
+    return self->CpuNanoseconds > Overhead ? self->CpuNanoseconds - Overhead : 0;
+}
+
+// everything the measurement found, kept in the arenas
+LP_BRN BM_Result( LP_BM self, const char* Title )
+{
+    static bool Warned = 0;
+    BM_Reclaim( self );
+    size_t SampleCount = self->Recorded;
+    double Overhead    = BM_LoopOverhead();
+    if( SampleCount < self->SampleCount && ! Warned )
+    {
+        Warned = 1;
+        fprintf( stderr, "\nSampleArena is full, %s and later results miss samples or "
+                         "percentiles, raise MaxSamples\n",
+                 Title );
+    }
+    for( size_t i = 0; i < SampleCount; ++i )
+        self->Samples[ i ] = self->Samples[ i ] > Overhead ? self->Samples[ i ] - Overhead : 0;
+    LP_BRN Node        = BRN_New( Title, BM_NetCycle( self ), self->TotalIteration );
+    Node               = BRN_WithAllocations( Node, self->Allocations );
+    Node               = BRN_WithResources( Node, self->Resources );
+    Node               = BRN_WithCpuTime( Node, BM_NetCpu( self ) );
+    return BRN_WithSamples( Node, self->Samples, SampleCount );
+}
 
 ////////////////////////////// BenchmarkModulator [End] //////////////////////////////
 
@@ -157,17 +911,163 @@ typedef struct BenchmarkModulatorTag
 #define UniqueVarID( Name, ID )  UniqueVarID_( Name, ID )
 #define UniqueName               UniqueVarID( _0_, __LINE__ )
 
-#define Benchmark( Title )                                                      \
-    ; /*single line control block skip*/                                        \
-    printf( "\nBenchmarking... %s\n", Title );                                  \
-    AutoRelease( BenchmarkAnalyser )* UniqueName =                              \
-    BenchmarkResults.ListHead ? NULL : &BenchmarkResults;                       \
-    for( BenchmarkModulator Mod = { clock(), 0, 0 };                            \
-         ( Mod.TotalCycle < MaxCycle && Mod.TotalIteration < MaxIteration ) ||  \
-         ( BA_PushBack( &BenchmarkResults,                                      \
-                        BRN_New( Title, Mod.TotalCycle, Mod.TotalIteration ) ), \
-           0 );                                                                 \
-         Mod.TotalCycle = clock() - Mod.StartTime, ++Mod.TotalIteration )
+#define Benchmark( Title )                                                               \
+    ; /*single line control block skip*/                                                 \
+    fprintf( stderr, "\nBenchmarking... %s\n", Title );                                  \
+    BM_LoopOverhead();                                                                   \
+    AutoRelease( BenchmarkAnalyser )* UniqueName =                                       \
+    BenchmarkResults.ResultCount || BenchmarkResults.Enabled ? NULL : &BenchmarkResults; \
+    for( BenchmarkModulator Mod = BM_Start();                                            \
+         BM_Alive( &Mod ) ||                                                             \
+         ( BA_PushBack( &BenchmarkResults, BM_Result( &Mod, Title ) ), 0 ); )
+
+// the summary is printed once the enclosing scope ends, rather than after the first scope
+// containing a Benchmark
+#define EnableBenchmark()                                 \
+    AutoRelease( BenchmarkAnalyser )* BenchmarkResults_ = \
+    ( BenchmarkResults.Enabled = 1, &BenchmarkResults )
+
+////////////////////////////// BenchmarkRegistry [Class] //////////////////////////////
+////////////////////////////// BenchmarkRegistry [Fields] //////////////////////////////
+#ifndef MaxRegistered
+#define MaxRegistered 1024
+#endif
+
+typedef void ( *BenchmarkFunction )( const char* Title );
+
+typedef struct BenchmarkRegistryTag
+{
+    const char* Title;
+    BenchmarkFunction Function;
+} BenchmarkRegistry, *LP_BR;
+
+////////////////////////////// BenchmarkRegistry [static] ////////////////////////////////////
+static BenchmarkRegistry RegisteredBenchmarks[ MaxRegistered ];
+static size_t RegisteredCount = 0;
+
+////////////////////////////// BenchmarkRegistry [Methods] //////////////////////////////
+void BR_Add( const char* Title, BenchmarkFunction Function )
+{
+    if( RegisteredCount == MaxRegistered )
+    {
+        puts( "BenchmarkRegistry Registration Failed, raise MaxRegistered" );
+        getchar();
+        exit( EXIT_FAILURE );
+    }
+    RegisteredBenchmarks[ RegisteredCount ].Title    = Title;
+    RegisteredBenchmarks[ RegisteredCount ].Function = Function;
+    ++RegisteredCount;
+}
+
+// seconds, or a number with an ns / us / ms / s suffix
+bool BR_ParseTime( const char* Text, clock_t* Cycle )
+{
+    char* Unit;
+    double Value = strtod( Text, &Unit );
+    double Scale = strcmp( Unit, "ns" ) == 0                   ? 1e-9
+                   : strcmp( Unit, "us" ) == 0                 ? 1e-6
+                   : strcmp( Unit, "ms" ) == 0                 ? 1e-3
+                   : strcmp( Unit, "s" ) == 0 || *Unit == '\0' ? 1
+                                                               : -1;
+    if( Unit == Text || Value < 0 || Scale < 0 ) return 0;
+    *Cycle = (clock_t)( Value * Scale * CLOCKS_PER_SEC );
+    return 1;
+}
+
+void BR_Run( regex_t* Filter, size_t Repetitions, const char* Format )
+{
+    EnableBenchmark();
+    if( strcmp( Format, "console" ) != 0 ) BA_ReportTo( &BenchmarkResults, Format, NULL );
+    for( size_t i = 0; i < RegisteredCount; ++i )
+    {
+        LP_BR Entry = &RegisteredBenchmarks[ i ];
+        if( Filter && regexec( Filter, Entry->Title, 0, NULL, 0 ) != 0 ) continue;
+        for( size_t Repetition = 0; Repetition < Repetitions; ++Repetition )
+            Entry->Function( Entry->Title );
+    }
+}
+
+// runs the registered benchmarks that match the options, the result is meant to be returned
+// from main. --repetitions runs each benchmark that many times, one summary line per run
+int BenchmarkMain( int argc, char** argv )
+{
+    regex_t Pattern;
+    regex_t* Filter    = NULL;
+    const char* Format = "console";
+    bool List          = 0;
+    size_t Repetitions = 1;
+    for( int i = 1; i < argc; ++i )
+    {
+        const char* Arg = argv[ i ];
+        bool Valid      = 1;
+        if( strncmp( Arg, "--filter=", 9 ) == 0 )
+        {
+            if( Filter ) regfree( Filter ), Filter = NULL;
+            Valid = regcomp( &Pattern, Arg + 9, REG_EXTENDED | REG_NOSUB ) == 0;
+            if( Valid ) Filter = &Pattern;
+        }
+        else if( strcmp( Arg, "--list" ) == 0 )
+            List = 1;
+        else if( strncmp( Arg, "--repetitions=", 14 ) == 0 )
+        {
+            char* End;
+            Repetitions = strtoul( Arg + 14, &End, 10 );
+            Valid       = End != Arg + 14 && *End == '\0' && Repetitions > 0;
+        }
+        else if( strncmp( Arg, "--min-time=", 11 ) == 0 )
+            Valid = BR_ParseTime( Arg + 11, &BM_MinCycle );
+        else if( strncmp( Arg, "--clock=", 8 ) == 0 )
+            Valid = BC_Select( Arg + 8 );
+        else if( strncmp( Arg, "--format=", 9 ) == 0 )
+        {
+            Format = Arg + 9;
+            Valid  = strcmp( Format, "console" ) == 0 || strcmp( Format, "json" ) == 0 ||
+                     strcmp( Format, "csv" ) == 0;
+        }
+        else
+            Valid = 0;
+
+        if( ! Valid )
+        {
+            fprintf( stderr,
+                     "Invalid option : %s\n"
+                     "usage : %s [--filter=<regex>] [--list] [--repetitions=<n>]"
+                     " [--min-time=<time>] [--format=console|json|csv]"
+                     " [--clock=monotonic_raw|process_cputime|thread_cputime|tsc]\n",
+                     Arg, argv[ 0 ] );
+            if( Filter ) regfree( Filter );
+            return EXIT_FAILURE;
+        }
+    }
+    if( BM_MaxCycle < BM_MinCycle ) BM_MaxCycle = BM_MinCycle;
+
+    if( List )
+    {
+        for( size_t i = 0; i < RegisteredCount; ++i )
+            if( ! Filter || regexec( Filter, RegisteredBenchmarks[ i ].Title, 0, NULL, 0 ) == 0 )
+                puts( RegisteredBenchmarks[ i ].Title );
+    }
+    else
+        BR_Run( Filter, Repetitions, Format );
+    if( Filter ) regfree( Filter );
+    return EXIT_SUCCESS;
+}
+
+////////////////////////////// BenchmarkRegistry [End] //////////////////////////////
+
+// records a benchmark without running it, Title holds the quoted Name :
+// BENCHMARK( PushBack ) { Benchmark( Title ) { ... } }
+#define BENCHMARK( Name )                                                \
+    static void Name( const char* Title );                               \
+    __attribute__( ( constructor ) ) static void Name##_Register( void ) \
+    {                                                                    \
+        BR_Add( #Name, Name );                                           \
+    }                                                                    \
+    static void Name( __attribute__( ( unused ) ) const char* Title )
+
+#define BENCHMARK_MAIN()                                                      \
+    int main( int argc, char** argv ) { return BenchmarkMain( argc, argv ); }
+
 
 #ifdef __cplusplus
 }
@@ -178,14 +1078,14 @@ typedef struct BenchmarkModulatorTag
 #define DONT_RUN_TEST_
 #ifndef DONT_RUN_TEST
 
-#include <math.h>
-void task( int k )
-{
-    printf( "Performing task . " );
-    volatile double m;
-    for( int i = 0; i < k; ++i )
-        for( int j = 0; j < k; ++j ) m = sqrt( pow( cos( i ), sin( j ) ) );
-    printf( "Complete.\n" );
+#include <math.h>
+void task( int k )
+{
+    printf( "Performing task . " );
+    volatile double m;
+    for( int i = 0; i < k; ++i )
+        for( int j = 0; j < k; ++j ) m = sqrt( pow( cos( i ), sin( j ) ) );
+    printf( "Complete.\n" );
 }
 
 int main()
@@ -198,6 +1098,11 @@ int main()
     {
         for( volatile int i = 0; i < 100; ++i ) {}
     }
+
+    Benchmark( "DoNotOptimize increment" )
+    {
+        for( int i = 0; i < 100; ++i ) DoNotOptimize( i );
+    }
 }
 
 #endif
\ No newline at end of file